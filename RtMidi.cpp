@@ -38,7 +38,23 @@
 /**********************************************************************/
 
 #include "RtMidi.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <sstream>
+#include <thread>
+
+// The input queue can signal a pollable descriptor on POSIX systems.
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+  #define RTMIDI_HAVE_POLL_DESCRIPTOR
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <stdint.h>
+  #include <unistd.h>
+  #if defined(__linux__)
+    #include <sys/eventfd.h>
+  #endif
+#endif
 
 using namespace rt::midi;
 
@@ -152,6 +168,12 @@ class MidiInJack: public MidiInApi
   void setPortName( const std::string &portName);
   unsigned int getPortCount( void );
   std::string getPortName( unsigned int portNumber );
+  void setPortCallback( RtMidi::RtMidiPortCallback callback, void *userData );
+  void setSystemBufferSize( unsigned int bufferSize, unsigned int poolSize );
+  unsigned long getOverrunCount( void );
+  unsigned int getSystemBufferFill( void );
+  unsigned int getSystemBufferPeak( void );
+  void setRealtimeDelivery( bool realtime );
 
  protected:
   std::string clientName;
@@ -173,7 +195,14 @@ class MidiOutJack: public MidiOutApi
   void setPortName( const std::string &portName);
   unsigned int getPortCount( void );
   std::string getPortName( unsigned int portNumber );
+  void setPortCallback( RtMidi::RtMidiPortCallback callback, void *userData );
   void sendMessage( const unsigned char *message, size_t size );
+  void sendMessageAt( int64_t monotonicTime, const unsigned char *message, size_t size );
+  bool trySendMessage( const unsigned char *message, size_t size );
+  void setSystemBufferSize( unsigned int bufferSize, unsigned int poolSize );
+  unsigned long getOverrunCount( void );
+  unsigned int getSystemBufferFill( void );
+  unsigned int getSystemBufferPeak( void );
 
  protected:
   std::string clientName;
@@ -199,9 +228,19 @@ class MidiInAlsa: public MidiInApi
   void setPortName( const std::string &portName);
   unsigned int getPortCount( void );
   std::string getPortName( unsigned int portNumber );
+  void setSystemBufferSize( unsigned int bufferSize, unsigned int poolSize );
+  unsigned long getOverrunCount( void );
+  unsigned long getLostEventCount( void );
+  void setPortCallback( RtMidi::RtMidiPortCallback callback, void *userData );
+  void ignoreMessageTypes( unsigned int types );
+  void setThreadScheduling( RtMidiIn::ThreadScheduling scheduling, int priority );
+  void setThreadAffinity( const std::vector<unsigned int> &cpus );
+  void setThreadName( const std::string &name );
 
  protected:
   void initialize( const std::string& clientName );
+  void startThread( void );
+  void applyThreadOptions( void );
 };
 
 class MidiOutAlsa: public MidiOutApi
@@ -217,10 +256,21 @@ class MidiOutAlsa: public MidiOutApi
   void setPortName( const std::string &portName );
   unsigned int getPortCount( void );
   std::string getPortName( unsigned int portNumber );
+  void setSystemBufferSize( unsigned int bufferSize, unsigned int poolSize );
+  unsigned long getOverrunCount( void );
+  unsigned long getLostEventCount( void );
+  void setPortCallback( RtMidi::RtMidiPortCallback callback, void *userData );
   void sendMessage( const unsigned char *message, size_t size );
+  void sendMessages( const unsigned char *bytes, const size_t *offsets, size_t count );
+  void sendMessageAt( int64_t monotonicTime, const unsigned char *message, size_t size );
+  void setFlushPolicy( RtMidiOut::FlushPolicy policy, double maxLatency );
+  void flush( void );
 
  protected:
   void initialize( const std::string& clientName );
+  void writeMessages( const unsigned char *bytes, const size_t *offsets, size_t count, int64_t queueTime );
+  bool outputMessage( const unsigned char *message, size_t size, int64_t queueTime );
+  void stopFlushThread( void );
 };
 
 #endif
@@ -394,7 +444,7 @@ class MidiInAndroid : public MidiInApi
   pthread_t readThread;
   std::atomic<bool> reading = ATOMIC_VAR_INIT(false);
   static void* pollMidi(void* context);
-  double lastTime;
+  int64_t lastTime;
 };
 
 class MidiOutAndroid: public MidiOutApi
@@ -574,6 +624,18 @@ RtMidi::Api RtMidi :: getCompiledApiByName( const std::string &name )
   return RtMidi::UNSPECIFIED;
 }
 
+static std::atomic<bool> rtmidi_shared_client( false );
+
+void RtMidi :: setSharedClient( bool shared )
+{
+  rtmidi_shared_client = shared;
+}
+
+bool RtMidi :: isSharedClient( void )
+{
+  return rtmidi_shared_client;
+}
+
 void RtMidi :: setClientName( const std::string &clientName )
 {
   rtapi_->setClientName( clientName );
@@ -584,12 +646,43 @@ void RtMidi :: setPortName( const std::string &portName )
   rtapi_->setPortName( portName );
 }
 
+void RtMidi :: setSystemBufferSize( unsigned int bufferSize, unsigned int poolSize )
+{
+  rtapi_->setSystemBufferSize( bufferSize, poolSize );
+}
+
+unsigned long RtMidi :: getOverrunCount( void )
+{
+  return rtapi_->getOverrunCount();
+}
+
+unsigned long RtMidi :: getLostEventCount( void )
+{
+  return rtapi_->getLostEventCount();
+}
+
+unsigned int RtMidi :: getSystemBufferFill( void )
+{
+  return rtapi_->getSystemBufferFill();
+}
+
+unsigned int RtMidi :: getSystemBufferPeak( void )
+{
+  return rtapi_->getSystemBufferPeak();
+}
+
+void RtMidi :: setPortCallback( RtMidiPortCallback callback, void *userData )
+{
+  rtapi_->setPortCallback( callback, userData );
+}
+
 
 //*********************************************************************//
 //  RtMidiIn Definitions
 //*********************************************************************//
 
-void RtMidiIn :: openMidiApi( RtMidi::Api api, const std::string &clientName, unsigned int queueSizeLimit )
+void RtMidiIn :: openMidiApi( RtMidi::Api api, const std::string &clientName, unsigned int queueSizeLimit,
+                              QueueOverflowPolicy overflowPolicy, unsigned int queueSizeCap )
 {
   delete rtapi_;
   rtapi_ = 0;
@@ -626,14 +719,18 @@ void RtMidiIn :: openMidiApi( RtMidi::Api api, const std::string &clientName, un
   if ( api == RTMIDI_DUMMY )
     rtapi_ = new MidiInDummy( clientName, queueSizeLimit );
 #endif
+
+  if ( rtapi_ && ( overflowPolicy != QUEUE_DROP_NEWEST || queueSizeCap ) )
+    static_cast<MidiInApi *>( rtapi_ )->setQueueOverflowPolicy( overflowPolicy, queueSizeCap );
 }
 
-RTMIDI_DLL_PUBLIC RtMidiIn :: RtMidiIn( RtMidi::Api api, const std::string &clientName, unsigned int queueSizeLimit )
+RTMIDI_DLL_PUBLIC RtMidiIn :: RtMidiIn( RtMidi::Api api, const std::string &clientName, unsigned int queueSizeLimit,
+                                        QueueOverflowPolicy overflowPolicy, unsigned int queueSizeCap )
   : RtMidi()
 {
   if ( api != UNSPECIFIED ) {
     // Attempt to open the specified API.
-    openMidiApi( api, clientName, queueSizeLimit );
+    openMidiApi( api, clientName, queueSizeLimit, overflowPolicy, queueSizeCap );
     if ( rtapi_ ) return;
 
     // No compiled support for specified API value.  Issue a warning
@@ -646,7 +743,7 @@ RTMIDI_DLL_PUBLIC RtMidiIn :: RtMidiIn( RtMidi::Api api, const std::string &clie
   std::vector< RtMidi::Api > apis;
   getCompiledApi( apis );
   for ( unsigned int i=0; i<apis.size(); i++ ) {
-    openMidiApi( apis[i], clientName, queueSizeLimit );
+    openMidiApi( apis[i], clientName, queueSizeLimit, overflowPolicy, queueSizeCap );
     if ( rtapi_ && rtapi_->getPortCount() ) break;
   }
 
@@ -664,6 +761,16 @@ RtMidiIn :: ~RtMidiIn() throw()
 {
 }
 
+int64_t RtMidiIn :: getMonotonicTime( void )
+{
+  // steady_clock is CLOCK_MONOTONIC with libstdc++ and libc++ on Linux,
+  // and the Mach host time on macOS.
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+const bool RtMidiIn::Clock :: is_steady;
+
 
 //*********************************************************************//
 //  RtMidiOut Definitions
@@ -756,12 +863,44 @@ MidiApi :: ~MidiApi( void )
 {
 }
 
+void MidiApi :: setSystemBufferSize( unsigned int, unsigned int )
+{
+  errorString_ = "MidiApi::setSystemBufferSize: the current API does not support sizing its buffers.";
+  error( RtMidiError::WARNING, errorString_ );
+}
+
+unsigned long MidiApi :: getOverrunCount( void )
+{
+  return 0;
+}
+
+unsigned long MidiApi :: getLostEventCount( void )
+{
+  return 0;
+}
+
+unsigned int MidiApi :: getSystemBufferFill( void )
+{
+  return 0;
+}
+
+unsigned int MidiApi :: getSystemBufferPeak( void )
+{
+  return 0;
+}
+
 void MidiApi :: setErrorCallback( RtMidiErrorCallback errorCallback, void *userData = 0 )
 {
     errorCallback_ = errorCallback;
     errorCallbackUserData_ = userData;
 }
 
+void MidiApi :: setPortCallback( RtMidi::RtMidiPortCallback, void * )
+{
+  errorString_ = "MidiApi::setPortCallback: the current API does not report port changes.";
+  error( RtMidiError::WARNING, errorString_ );
+}
+
 void MidiApi :: error( RtMidiError::Type type, std::string errorString )
 {
   if ( errorCallback_ ) {
@@ -799,15 +938,11 @@ MidiInApi :: MidiInApi( unsigned int queueSizeLimit )
   : MidiApi()
 {
   // Allocate the MIDI queue.
-  inputData_.queue.ringSize = queueSizeLimit;
-  if ( inputData_.queue.ringSize > 0 )
-    inputData_.queue.ring = new MidiMessage[ inputData_.queue.ringSize ];
+  inputData_.queue.init( queueSizeLimit );
 }
 
 MidiInApi :: ~MidiInApi( void )
 {
-  // Delete the MIDI queue.
-  if ( inputData_.queue.ringSize > 0 ) delete [] inputData_.queue.ring;
 }
 
 void MidiInApi :: setCallback( RtMidiIn::RtMidiCallback callback, void *userData )
@@ -825,6 +960,112 @@ void MidiInApi :: setCallback( RtMidiIn::RtMidiCallback callback, void *userData
   }
 
   inputData_.userCallback = callback;
+  inputData_.rawCallback = 0;
+  inputData_.infoCallback = 0;
+  inputData_.batchCallback = 0;
+  inputData_.timedBatchCallback = 0;
+  inputData_.userData = userData;
+  inputData_.usingCallback = true;
+}
+
+void MidiInApi :: setCallback( RtMidiIn::RtMidiRawCallback callback, void *userData )
+{
+  if ( inputData_.usingCallback ) {
+    errorString_ = "MidiInApi::setCallback: a callback function is already set!";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  if ( !callback ) {
+    errorString_ = "RtMidiIn::setCallback: callback function value is invalid!";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  inputData_.userCallback = 0;
+  inputData_.rawCallback = callback;
+  inputData_.infoCallback = 0;
+  inputData_.batchCallback = 0;
+  inputData_.timedBatchCallback = 0;
+  inputData_.userData = userData;
+  inputData_.usingCallback = true;
+}
+
+void MidiInApi :: setCallback( RtMidiIn::RtMidiInfoCallback callback, void *userData )
+{
+  if ( inputData_.usingCallback ) {
+    errorString_ = "MidiInApi::setCallback: a callback function is already set!";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  if ( !callback ) {
+    errorString_ = "RtMidiIn::setCallback: callback function value is invalid!";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  inputData_.userCallback = 0;
+  inputData_.rawCallback = 0;
+  inputData_.infoCallback = callback;
+  inputData_.batchCallback = 0;
+  inputData_.timedBatchCallback = 0;
+  inputData_.userData = userData;
+  inputData_.usingCallback = true;
+}
+
+void MidiInApi :: setCallback( RtMidiIn::RtMidiBatchCallback callback, void *userData )
+{
+  if ( inputData_.usingCallback ) {
+    errorString_ = "MidiInApi::setCallback: a callback function is already set!";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  if ( !callback ) {
+    errorString_ = "RtMidiIn::setCallback: callback function value is invalid!";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  inputData_.userCallback = 0;
+  inputData_.rawCallback = 0;
+  inputData_.infoCallback = 0;
+  inputData_.batchCallback = callback;
+  inputData_.timedBatchCallback = 0;
+  inputData_.batchBytes.reserve( 3 * RtMidiInData::MAX_BATCH );
+  inputData_.batchOffsets.reserve( RtMidiInData::MAX_BATCH + 1 );
+  inputData_.batchDeltas.reserve( RtMidiInData::MAX_BATCH );
+  inputData_.batchTimes.reserve( RtMidiInData::MAX_BATCH );
+  inputData_.batchTimeStamps.reserve( RtMidiInData::MAX_BATCH );
+  inputData_.batchMonotonicTimes.reserve( RtMidiInData::MAX_BATCH );
+  inputData_.userData = userData;
+  inputData_.usingCallback = true;
+}
+
+void MidiInApi :: setCallback( RtMidiIn::RtMidiTimedBatchCallback callback, void *userData )
+{
+  if ( inputData_.usingCallback ) {
+    errorString_ = "MidiInApi::setCallback: a callback function is already set!";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  if ( !callback ) {
+    errorString_ = "RtMidiIn::setCallback: callback function value is invalid!";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  inputData_.userCallback = 0;
+  inputData_.rawCallback = 0;
+  inputData_.infoCallback = 0;
+  inputData_.batchCallback = 0;
+  inputData_.timedBatchCallback = callback;
+  inputData_.batchBytes.reserve( 3 * RtMidiInData::MAX_BATCH );
+  inputData_.batchOffsets.reserve( RtMidiInData::MAX_BATCH + 1 );
+  inputData_.batchDeltas.reserve( RtMidiInData::MAX_BATCH );
+  inputData_.batchTimes.reserve( RtMidiInData::MAX_BATCH );
   inputData_.userData = userData;
   inputData_.usingCallback = true;
 }
@@ -838,16 +1079,37 @@ void MidiInApi :: cancelCallback()
   }
 
   inputData_.userCallback = 0;
+  inputData_.rawCallback = 0;
+  inputData_.infoCallback = 0;
+  inputData_.batchCallback = 0;
+  inputData_.timedBatchCallback = 0;
   inputData_.userData = 0;
   inputData_.usingCallback = false;
 }
 
 void MidiInApi :: ignoreTypes( bool midiSysex, bool midiTime, bool midiSense )
 {
+  unsigned int types = 0;
+  if ( midiSysex ) types |= RtMidiIn::TYPE_SYSEX;
+  if ( midiTime ) types |= RtMidiInData::TIME_TYPES;
+  if ( midiSense ) types |= RtMidiIn::TYPE_ACTIVE_SENSING;
+  ignoreMessageTypes( types );
+}
+
+// The APIs check ignoreFlags while they parse their input, and
+// deliver() drops the messages of any other ignored type.
+void MidiInApi :: ignoreMessageTypes( unsigned int types )
+{
+  inputData_.ignoredTypes = types;
   inputData_.ignoreFlags = 0;
-  if ( midiSysex ) inputData_.ignoreFlags = 0x01;
-  if ( midiTime ) inputData_.ignoreFlags |= 0x02;
-  if ( midiSense ) inputData_.ignoreFlags |= 0x04;
+  if ( types & RtMidiIn::TYPE_SYSEX ) inputData_.ignoreFlags = 0x01;
+  if ( ( types & RtMidiInData::TIME_TYPES ) == RtMidiInData::TIME_TYPES ) inputData_.ignoreFlags |= 0x02;
+  if ( types & RtMidiIn::TYPE_ACTIVE_SENSING ) inputData_.ignoreFlags |= 0x04;
+}
+
+unsigned int MidiInApi :: getIgnoredMessageTypes( void )
+{
+  return inputData_.ignoredTypes;
 }
 
 double MidiInApi :: getMessage( std::vector<unsigned char> *message )
@@ -867,122 +1129,786 @@ double MidiInApi :: getMessage( std::vector<unsigned char> *message )
   return timeStamp;
 }
 
-void MidiInApi :: setBufferSize( unsigned int size, unsigned int count )
+double MidiInApi :: getMessage( std::vector<unsigned char> *message, RtMidiIn::MessageInfo *info )
 {
-    inputData_.bufferSize = size;
-    inputData_.bufferCount = count;
+  message->clear();
+
+  if ( inputData_.usingCallback ) {
+    errorString_ = "RtMidiIn::getNextMessage: a user callback is currently set for this port.";
+    error( RtMidiError::WARNING, errorString_ );
+    return 0.0;
+  }
+
+  RtMidiIn::Duration delta;
+  RtMidiIn::TimePoint time;
+  if ( !inputData_.queue.pop( message, &delta, &time ) )
+    return 0.0;
+
+  info->delta = delta;
+  info->time = time;
+  info->timeStamp = std::chrono::duration<double>( delta ).count();
+  info->monotonicTime = time.time_since_epoch().count();
+  info->frameTime = -1;
+  info->apiTime = -1;
+  return info->timeStamp;
 }
 
-unsigned int MidiInApi::MidiQueue::size( unsigned int *__back,
-                                         unsigned int *__front )
+bool MidiInApi :: waitForMessage( double timeout )
 {
-  // Access back/front members exactly once and make stack copies for
-  // size calculation
-  unsigned int _back = back, _front = front, _size;
-  if ( _back >= _front )
-    _size = _back - _front;
-  else
-    _size = ringSize - _front + _back;
+  if ( inputData_.usingCallback ) {
+    errorString_ = "RtMidiIn::waitForMessage: a user callback is currently set for this port.";
+    error( RtMidiError::WARNING, errorString_ );
+    return false;
+  }
 
-  // Return copies of back/front so no new and unsynchronized accesses
-  // to member variables are needed.
-  if ( __back ) *__back = _back;
-  if ( __front ) *__front = _front;
-  return _size;
+  return inputData_.queue.wait( timeout );
 }
 
-// As long as we haven't reached our queue size limit, push the message.
-bool MidiInApi::MidiQueue::push( const MidiInApi::MidiMessage& msg )
+int MidiInApi :: getPollDescriptor( void )
 {
-  // Local stack copies of front/back
-  unsigned int _back, _front, _size;
+  return inputData_.queue.pollDescriptor();
+}
 
-  // Get back/front indexes exactly once and calculate current size
-  _size = size( &_back, &_front );
+void MidiInApi :: setQueueOverflowPolicy( RtMidiIn::QueueOverflowPolicy overflowPolicy, unsigned int queueSizeCap )
+{
+  // Only valid before a port is opened, since the queue is reallocated.
+  inputData_.queue.init( inputData_.queue.ringSize, overflowPolicy, queueSizeCap );
+}
 
-  if ( _size < ringSize-1 )
-  {
-    ring[_back] = msg;
-    back = (back+1)%ringSize;
-    return true;
-  }
+unsigned long MidiInApi :: getDroppedMessageCount( void )
+{
+  return inputData_.queue.dropped.load( std::memory_order_relaxed );
+}
 
-  return false;
+unsigned int MidiInApi :: getQueueHighWaterMark( void )
+{
+  return inputData_.queue.highWaterMark.load( std::memory_order_relaxed );
 }
 
-bool MidiInApi::MidiQueue::pop( std::vector<unsigned char> *msg, double* timeStamp )
+size_t MidiInApi :: getMessages( unsigned char *bytes, size_t bytesSize, size_t *offsets,
+                                 double *timeStamps, size_t maxMessages, int64_t *monotonicTimes )
 {
-  // Local stack copies of front/back
-  unsigned int _back, _front, _size;
+  offsets[0] = 0;
 
-  // Get back/front indexes exactly once and calculate current size
-  _size = size( &_back, &_front );
+  if ( inputData_.usingCallback ) {
+    errorString_ = "RtMidiIn::getMessages: a user callback is currently set for this port.";
+    error( RtMidiError::WARNING, errorString_ );
+    return 0;
+  }
 
-  if ( _size == 0 )
-    return false;
+  size_t count = inputData_.queue.pop( bytes, bytesSize, offsets, timeStamps, maxMessages, monotonicTimes );
+  if ( count == 0 && maxMessages > 0 && inputData_.queue.size() > 0 ) {
+    errorString_ = "RtMidiIn::getMessages: the next message does not fit in the provided buffer.";
+    error( RtMidiError::WARNING, errorString_ );
+  }
+
+  return count;
+}
 
-  // Copy queued message to the vector pointer argument and then "pop" it.
-  msg->assign( ring[_front].bytes.begin(), ring[_front].bytes.end() );
-  *timeStamp = ring[_front].timeStamp;
+size_t MidiInApi :: getMessages( unsigned char *bytes, size_t bytesSize, size_t *offsets,
+                                 size_t maxMessages, RtMidiIn::Duration *deltas, RtMidiIn::TimePoint *times )
+{
+  offsets[0] = 0;
 
-  // Update front
-  front = (front+1)%ringSize;
-  return true;
+  if ( inputData_.usingCallback ) {
+    errorString_ = "RtMidiIn::getMessages: a user callback is currently set for this port.";
+    error( RtMidiError::WARNING, errorString_ );
+    return 0;
+  }
+
+  size_t count = inputData_.queue.pop( bytes, bytesSize, offsets, maxMessages, deltas, times );
+  if ( count == 0 && maxMessages > 0 && inputData_.queue.size() > 0 ) {
+    errorString_ = "RtMidiIn::getMessages: the next message does not fit in the provided buffer.";
+    error( RtMidiError::WARNING, errorString_ );
+  }
+
+  return count;
 }
 
-//*********************************************************************//
-//  Common MidiOutApi Definitions
-//*********************************************************************//
+void MidiInApi :: setBufferSize( unsigned int size, unsigned int count )
+{
+    inputData_.bufferSize = size;
+    inputData_.bufferCount = count;
+}
 
-MidiOutApi :: MidiOutApi( void )
-  : MidiApi()
+void MidiInApi :: setThreadScheduling( RtMidiIn::ThreadScheduling, int )
 {
+  errorString_ = "MidiInApi::setThreadScheduling: the current API does not run its own input thread.";
+  error( RtMidiError::WARNING, errorString_ );
 }
 
-MidiOutApi :: ~MidiOutApi( void )
+void MidiInApi :: setThreadAffinity( const std::vector<unsigned int> & )
 {
+  errorString_ = "MidiInApi::setThreadAffinity: the current API does not run its own input thread.";
+  error( RtMidiError::WARNING, errorString_ );
 }
 
-// *************************************************** //
-//
-// OS/API-specific methods.
-//
-// *************************************************** //
+void MidiInApi :: setThreadName( const std::string & )
+{
+  errorString_ = "MidiInApi::setThreadName: the current API does not run its own input thread.";
+  error( RtMidiError::WARNING, errorString_ );
+}
 
-#if defined(__MACOSX_CORE__)
+void MidiInApi :: setRealtimeDelivery( bool realtime )
+{
+  if ( !realtime ) return;
+  errorString_ = "MidiInApi::setRealtimeDelivery: the current API does not deliver input from a real-time thread.";
+  error( RtMidiError::WARNING, errorString_ );
+}
 
-// The CoreMIDI API is based on the use of a callback function for
-// MIDI input.  We convert the system specific time stamps to delta
-// time values.
+// Return the RtMidiIn::MessageType of a status byte, or 0 for data
+// bytes and undefined status bytes.
+static unsigned int messageType( unsigned char status )
+{
+  static const unsigned int systemTypes[16] = {
+    RtMidiIn::TYPE_SYSEX, RtMidiIn::TYPE_TIME_CODE, RtMidiIn::TYPE_SONG_POSITION, RtMidiIn::TYPE_SONG_SELECT,
+    0, 0, RtMidiIn::TYPE_TUNE_REQUEST, 0,
+    RtMidiIn::TYPE_CLOCK, RtMidiIn::TYPE_TICK, RtMidiIn::TYPE_START, RtMidiIn::TYPE_CONTINUE,
+    RtMidiIn::TYPE_STOP, 0, RtMidiIn::TYPE_ACTIVE_SENSING, RtMidiIn::TYPE_SYSTEM_RESET
+  };
+  if ( status < 0x80 ) return 0;
+  if ( status < 0xF0 ) return 1u << ( ( status >> 4 ) - 8 );
+  return systemTypes[status & 0x0F];
+}
+
+// Pass a complete message to the user callback or push it to the queue.
+// Times stay integer nanoseconds up to the callbacks that take a double
+// time stamp in seconds.  Only a vector callback requires the bytes to
+// be copied.  Backends that collect messages in a MidiMessage use the
+// second version, which hands that vector to a vector callback as is
+// and stamps messages without an absolute time with the current time.
+void MidiInApi::RtMidiInData :: deliver( const unsigned char *bytes, size_t size, RtMidiIn::Duration delta,
+                                          RtMidiIn::TimePoint time, int64_t frameTime, int64_t apiTime )
+{
+  if ( size > 0 && ( ignoredTypes & messageType( bytes[0] ) ) ) return;
+
+  if ( !usingCallback ) {
+    // Overflows are counted by the queue.
+    queue.push( bytes, size, delta, time );
+  }
+  else if ( rawCallback ) {
+    rawCallback( std::chrono::duration<double>( delta ).count(), bytes, size, userData );
+  }
+  else if ( infoCallback ) {
+    RtMidiIn::MessageInfo info;
+    info.timeStamp = std::chrono::duration<double>( delta ).count();
+    info.monotonicTime = time.time_since_epoch().count();
+    info.frameTime = frameTime;
+    info.apiTime = apiTime;
+    info.delta = delta;
+    info.time = time;
+    infoCallback( info, bytes, size, userData );
+  }
+  else if ( batchCallback || timedBatchCallback ) {
+    batchBytes.insert( batchBytes.end(), bytes, bytes + size );
+    batchOffsets.push_back( batchBytes.size() );
+    batchDeltas.push_back( delta );
+    batchTimes.push_back( time );
+    if ( !batching || batchDeltas.size() >= MAX_BATCH )
+      flushBatch();
+  }
+  else {
+    if ( bytes != message.bytes.data() )
+      message.bytes.assign( bytes, bytes + size );
+    userCallback( std::chrono::duration<double>( delta ).count(), &message.bytes, userData );
+  }
+}
+
+// Pass the messages collected since the last call to the batch
+// callback.  The buffers keep their capacity, so that collecting
+// messages does not allocate once they have grown.
+void MidiInApi::RtMidiInData :: flushBatch()
+{
+  size_t count = batchDeltas.size();
+  if ( count == 0 ) return;
+  if ( timedBatchCallback )
+    timedBatchCallback( count, batchBytes.data(), batchOffsets.data(), batchDeltas.data(),
+                        batchTimes.data(), userData );
+  else if ( batchCallback ) {
+    batchTimeStamps.clear();
+    batchMonotonicTimes.clear();
+    for ( size_t i = 0; i < count; i++ ) {
+      batchTimeStamps.push_back( std::chrono::duration<double>( batchDeltas[i] ).count() );
+      batchMonotonicTimes.push_back( batchTimes[i].time_since_epoch().count() );
+    }
+    batchCallback( count, batchBytes.data(), batchOffsets.data(), batchTimeStamps.data(),
+                   batchMonotonicTimes.data(), userData );
+  }
+  batchBytes.clear();
+  batchOffsets.resize( 1 );
+  batchDeltas.clear();
+  batchTimes.clear();
+}
 
-// These are not available on iOS.
-#if (TARGET_OS_IPHONE == 0)
-  #include <CoreAudio/HostTime.h>
-  #include <CoreServices/CoreServices.h>
-#endif
+void MidiInApi::RtMidiInData :: deliver( MidiMessage &msg )
+{
+  if ( msg.bytes.size() > 0 && ( ignoredTypes & messageType( msg.bytes[0] ) ) ) return;
 
-// A structure to hold variables related to the CoreMIDI API
-// implementation.
-struct CoreMidiData {
-  MIDIClientRef client;
-  MIDIPortRef port;
-  MIDIEndpointRef endpoint;
-  MIDIEndpointRef destinationId;
-  unsigned long long lastTime;
-  MIDISysexSendRequest sysexreq;
-};
+  if ( usingCallback && userCallback )
+    userCallback( std::chrono::duration<double>( msg.delta ).count(), &msg.bytes, userData );
+  else
+    deliver( msg.bytes.data(), msg.bytes.size(), msg.delta,
+             msg.time.time_since_epoch().count() ? msg.time : RtMidiIn::Clock::now() );
+}
 
-static MIDIClientRef CoreMidiClientSingleton = 0;
+MidiInApi::MidiQueue::Segment :: Segment( unsigned int n, unsigned int first )
+  : ring( new Slot[n] ), spill( 0 ), size( n ), mask( n - 1 ), base( first ), next( 0 )
+{
+}
 
-void RtMidi_setCoreMidiClientSingleton(MIDIClientRef client){
-  CoreMidiClientSingleton = client;
+MidiInApi::MidiQueue::Segment :: ~Segment()
+{
+  delete [] ring;
+  delete [] spill;
 }
 
-void RtMidi_disposeCoreMidiClientSingleton(){
-  if (CoreMidiClientSingleton == 0){
-    return;
+MidiInApi::MidiQueue :: ~MidiQueue()
+{
+  while ( head ) {
+    Segment *next = head->next.load( std::memory_order_relaxed );
+    delete head;
+    head = next;
   }
-  MIDIClientDispose( CoreMidiClientSingleton );
+  delete [] arena;
+#if defined(RTMIDI_HAVE_POLL_DESCRIPTOR)
+  if ( notifyFds[1] >= 0 && notifyFds[1] != notifyFds[0] ) close( notifyFds[1] );
+  if ( notifyFds[0] >= 0 ) close( notifyFds[0] );
+#endif
+}
+
+void MidiInApi::MidiQueue :: init( unsigned int queueSizeLimit,
+                                   RtMidiIn::QueueOverflowPolicy overflowPolicy,
+                                   unsigned int queueSizeCap )
+{
+  while ( head ) {
+    Segment *next = head->next.load( std::memory_order_relaxed );
+    delete head;
+    head = next;
+  }
+  tail = 0;
+  delete [] arena;
+  arena = 0;
+  arenaSize = 0;
+  arenaBack = 0;
+  arenaFront.store( 0, std::memory_order_relaxed );
+  ringSize = 0;
+  sizeCap = 0;
+  policy = overflowPolicy;
+  front.store( 0, std::memory_order_relaxed );
+  back.store( 0, std::memory_order_relaxed );
+  readSlot.store( 0, std::memory_order_relaxed );
+  highWaterMark.store( 0, std::memory_order_relaxed );
+  dropped.store( 0, std::memory_order_relaxed );
+  if ( queueSizeLimit == 0 ) return;
+
+  // Round the requested size up to a power of two so that slot
+  // indices can be computed with a mask instead of a modulo.
+  unsigned int n = 1;
+  while ( n < queueSizeLimit && n < 0x80000000u ) n <<= 1;
+  ringSize = n;
+  sizeCap = n;
+  if ( policy == RtMidiIn::QUEUE_GROW ) {
+    unsigned long long cap = queueSizeCap ? queueSizeCap : 16ULL * queueSizeLimit;
+    if ( cap > 0x80000000u ) cap = 0x80000000u;
+    if ( cap > n ) sizeCap = static_cast<unsigned int>( cap );
+  }
+  head = tail = new Segment( n, 0 );
+
+  unsigned int bytes = MIN_ARENA_SIZE;
+  while ( bytes < n * (unsigned long long) ARENA_BYTES_PER_SLOT && bytes < 0x10000000u ) bytes <<= 1;
+  arena = new unsigned char[bytes];
+  arenaSize = bytes;
+}
+
+unsigned int MidiInApi::MidiQueue::size( unsigned int *__back,
+                                         unsigned int *__front )
+{
+  // Access back/front members exactly once and make stack copies for
+  // size calculation.  Indices run freely and wrap, so the unsigned
+  // difference is the number of queued messages.
+  unsigned int _back = back.load( std::memory_order_acquire );
+  unsigned int _front = front.load( std::memory_order_acquire );
+
+  // Return copies of back/front so no new and unsynchronized accesses
+  // to member variables are needed.
+  if ( __back ) *__back = _back;
+  if ( __front ) *__front = _front;
+  return _back - _front;
+}
+
+// Push the message, applying the overflow policy if the queue is full.
+// Only the producer thread may call this function.
+bool MidiInApi::MidiQueue::push( const unsigned char *bytes, size_t size, RtMidiIn::Duration delta,
+                                 RtMidiIn::TimePoint time )
+{
+  if ( !tail ) {
+    dropped.fetch_add( 1, std::memory_order_relaxed );
+    return false;
+  }
+
+  unsigned int _back = back.load( std::memory_order_relaxed );
+  unsigned int _front = front.load( std::memory_order_acquire );
+  Segment *segment = tail;
+
+  // The tail segment is full when the distance between the back and
+  // the first index still in use within it reaches its size.
+  unsigned int first = (int) ( _front - segment->base ) > 0 ? _front : segment->base;
+  if ( _back - first >= segment->size || _back - _front >= sizeCap ) {
+    if ( policy == RtMidiIn::QUEUE_GROW && _back - _front < sizeCap ) {
+      // Chain a segment twice as large; the consumer moves to it once
+      // it has read everything before its base index.
+      segment = new Segment( segment->size * 2, _back );
+      tail->next.store( segment, std::memory_order_release );
+      tail = segment;
+    }
+    else if ( policy == RtMidiIn::QUEUE_DROP_OLDEST ) {
+      // Discard the front message, unless the consumer popped one in
+      // the meantime and made room.
+      if ( front.compare_exchange_strong( _front, _front + 1 ) ) {
+        dropped.fetch_add( 1, std::memory_order_relaxed );
+        _front++;
+      }
+    }
+    else {
+      dropped.fetch_add( 1, std::memory_order_relaxed );
+      return false;
+    }
+  }
+
+  // With QUEUE_DROP_OLDEST, the consumer may still be copying a message
+  // that has been dropped from the slot we are about to overwrite.
+  // Drop the new message in that case.
+  unsigned int index = _back & segment->mask;
+  if ( policy == RtMidiIn::QUEUE_DROP_OLDEST && readSlot.load() == index + 1 ) {
+    dropped.fetch_add( 1, std::memory_order_relaxed );
+    return false;
+  }
+
+  Slot &slot = segment->ring[index];
+  slot.delta = delta;
+  slot.time = time;
+  slot.size = static_cast<unsigned int>( size );
+  if ( size <= INLINE_SIZE ) {
+    // Cheaper than a memcpy() call for a few bytes.
+    for ( size_t i = 0; i < size; i++ ) slot.bytes[i] = bytes[i];
+  }
+  else
+    store( slot, segment, index, bytes, size );
+
+  // Publish the slot contents before the new back index.
+  back.store( _back + 1, std::memory_order_release );
+
+  unsigned int used = _back + 1 - _front;
+  if ( used > highWaterMark.load( std::memory_order_relaxed ) )
+    highWaterMark.store( used, std::memory_order_relaxed );
+
+  notify();
+  return true;
+}
+
+bool MidiInApi::MidiQueue::push( const unsigned char *bytes, size_t size, double timeStamp,
+                                 int64_t monotonicTime )
+{
+  return push( bytes, size, std::chrono::duration_cast<RtMidiIn::Duration>( std::chrono::duration<double>( timeStamp ) ),
+               RtMidiIn::TimePoint( RtMidiIn::Duration( monotonicTime ) ) );
+}
+
+bool MidiInApi::MidiQueue::push( const MidiInApi::MidiMessage& msg )
+{
+  return push( msg.bytes.data(), msg.bytes.size(), msg.delta,
+               msg.time.time_since_epoch().count() ? msg.time : RtMidiIn::Clock::now() );
+}
+
+// Copy a long message into the arena, wrapping around its end if
+// needed, or into the slot's spill vector if the arena is full.  Only
+// the producer thread may call this function.
+void MidiInApi::MidiQueue :: store( Slot &slot, Segment *segment, unsigned int index,
+                                    const unsigned char *bytes, size_t size )
+{
+  unsigned int used = arenaBack - arenaFront.load( std::memory_order_acquire );
+  if ( size <= arenaSize - used ) {
+    unsigned int offset = arenaBack & ( arenaSize - 1 );
+    size_t first = std::min( size, (size_t) ( arenaSize - offset ) );
+    memcpy( arena + offset, bytes, first );
+    memcpy( arena, bytes + first, size - first );
+    slot.offset = arenaBack;
+    arenaBack += static_cast<unsigned int>( size );
+    return;
+  }
+
+  if ( !segment->spill )
+    segment->spill = new std::vector<unsigned char>[segment->size];
+  segment->spill[index].assign( bytes, bytes + size );
+  slot.size |= SPILLED;
+}
+
+// Return the slot holding message "index", or NULL if the producer
+// dropped it before we could claim it.  Only the consumer may call this
+// function.
+const MidiInApi::MidiQueue::Slot *MidiInApi::MidiQueue :: peek( unsigned int index )
+{
+  // Move to the next segment (and free the current one) once all the
+  // messages before its base index have been read.
+  Segment *next = head->next.load( std::memory_order_acquire );
+  if ( next && index == next->base ) {
+    delete head;
+    head = next;
+  }
+
+  unsigned int slot = index & head->mask;
+  if ( policy == RtMidiIn::QUEUE_DROP_OLDEST ) {
+    // Announce the slot we are about to read, then make sure the
+    // producer did not drop the message before seeing the announcement.
+    readSlot.store( slot + 1 );
+    if ( front.load() != index ) {
+      readSlot.store( 0, std::memory_order_relaxed );
+      return 0;
+    }
+  }
+  return &head->ring[slot];
+}
+
+// Copy the bytes of a slot returned by peek().  Only the consumer
+// thread may call this function.
+void MidiInApi::MidiQueue :: copy( const Slot *slot, unsigned char *bytes )
+{
+  size_t size = slot->size & ~SPILLED;
+  if ( size <= INLINE_SIZE ) {
+    for ( size_t i = 0; i < size; i++ ) bytes[i] = slot->bytes[i];
+  }
+  else if ( slot->size & SPILLED )
+    memcpy( bytes, head->spill[slot - head->ring].data(), size );
+  else {
+    unsigned int offset = slot->offset & ( arenaSize - 1 );
+    size_t first = std::min( size, (size_t) ( arenaSize - offset ) );
+    memcpy( bytes, arena + offset, first );
+    memcpy( bytes + first, arena, size - first );
+  }
+}
+
+// Hand the slot of message "index" back to the producer.  Returns false
+// if the producer dropped the message while it was being read.
+bool MidiInApi::MidiQueue :: release( unsigned int index )
+{
+  if ( policy != RtMidiIn::QUEUE_DROP_OLDEST ) {
+    front.store( index + 1, std::memory_order_release );
+    return true;
+  }
+
+  bool kept = front.compare_exchange_strong( index, index + 1 );
+  readSlot.store( 0, std::memory_order_release );
+  return kept;
+}
+
+// Only the consumer thread may call this function.
+bool MidiInApi::MidiQueue::pop( std::vector<unsigned char> *msg, RtMidiIn::Duration *delta,
+                                RtMidiIn::TimePoint *time )
+{
+  for ( ;; ) {
+    unsigned int _front = front.load( std::memory_order_acquire );
+    if ( _front == back.load( std::memory_order_acquire ) ) {
+      arm();
+      return false;
+    }
+
+    // Copy queued message to the vector pointer argument and then "pop" it.
+    const Slot *slot = peek( _front );
+    if ( !slot ) continue;
+    size_t size = slot->size & ~SPILLED;
+    bool inArena = size > INLINE_SIZE && !( slot->size & SPILLED );
+    unsigned int arenaEnd = inArena ? slot->offset + static_cast<unsigned int>( size ) : 0;
+    if ( size <= INLINE_SIZE )
+      msg->assign( slot->bytes, slot->bytes + size );
+    else {
+      msg->resize( size );
+      copy( slot, msg->data() );
+    }
+    *delta = slot->delta;
+    if ( time ) *time = slot->time;
+
+    if ( release( _front ) ) {
+      // Arena bytes are freed in order, so this frees any bytes of
+      // messages dropped before this one too.
+      if ( inArena ) arenaFront.store( arenaEnd, std::memory_order_release );
+      return true;
+    }
+  }
+}
+
+bool MidiInApi::MidiQueue::pop( std::vector<unsigned char> *msg, double* timeStamp,
+                                int64_t *monotonicTime )
+{
+  RtMidiIn::Duration delta;
+  RtMidiIn::TimePoint time;
+  if ( !pop( msg, &delta, &time ) ) return false;
+  *timeStamp = std::chrono::duration<double>( delta ).count();
+  if ( monotonicTime ) *monotonicTime = time.time_since_epoch().count();
+  return true;
+}
+
+// Store the queued times for the integer or the double and int64_t
+// versions of the batch retrieval.
+static inline void convertTime( RtMidiIn::Duration delta, RtMidiIn::Duration *out ) { *out = delta; }
+static inline void convertTime( RtMidiIn::Duration delta, double *out ) { *out = std::chrono::duration<double>( delta ).count(); }
+static inline void convertTime( RtMidiIn::TimePoint time, RtMidiIn::TimePoint *out ) { *out = time; }
+static inline void convertTime( RtMidiIn::TimePoint time, int64_t *out ) { *out = time.time_since_epoch().count(); }
+
+// Pop several messages at once into a contiguous byte buffer.  Only the
+// consumer thread may call this function.
+template <typename Delta, typename Time>
+size_t MidiInApi::MidiQueue::popMessages( unsigned char *bytes, size_t bytesSize, size_t *offsets,
+                                          size_t maxMessages, Delta *deltas, Time *times )
+{
+  bool dropOldest = ( policy == RtMidiIn::QUEUE_DROP_OLDEST );
+  unsigned int _front = front.load( std::memory_order_acquire );
+  unsigned int _back = back.load( std::memory_order_acquire );
+  size_t count = 0, used = 0;
+  bool inArena = false;
+  unsigned int arenaEnd = 0;
+
+  offsets[0] = 0;
+  while ( count < maxMessages && (int) ( _back - _front ) > 0 ) {
+    const Slot *slot = peek( _front );
+    if ( !slot ) {
+      _front = front.load( std::memory_order_acquire );
+      continue;
+    }
+    size_t length = slot->size & ~SPILLED;
+    if ( length > bytesSize - used ) {
+      if ( dropOldest ) readSlot.store( 0, std::memory_order_release );
+      break;
+    }
+    bool slotInArena = length > INLINE_SIZE && !( slot->size & SPILLED );
+    unsigned int slotArenaEnd = slotInArena ? slot->offset + static_cast<unsigned int>( length ) : 0;
+    copy( slot, bytes + used );
+    if ( deltas ) convertTime( slot->delta, deltas + count );
+    if ( times ) convertTime( slot->time, times + count );
+    if ( dropOldest && !release( _front ) ) {
+      _front = front.load( std::memory_order_acquire );
+      continue;
+    }
+    if ( slotInArena ) {
+      inArena = true;
+      arenaEnd = slotArenaEnd;
+    }
+    used += length;
+    offsets[++count] = used;
+    _front++;
+  }
+
+  // Otherwise, release all consumed slots back to the producer at once.
+  if ( inArena )
+    arenaFront.store( arenaEnd, std::memory_order_release );
+  if ( !dropOldest && count > 0 )
+    front.store( _front, std::memory_order_release );
+  if ( (int) ( _back - _front ) <= 0 )
+    arm();
+  return count;
+}
+
+size_t MidiInApi::MidiQueue::pop( unsigned char *bytes, size_t bytesSize, size_t *offsets,
+                                  size_t maxMessages, RtMidiIn::Duration *deltas, RtMidiIn::TimePoint *times )
+{
+  return popMessages( bytes, bytesSize, offsets, maxMessages, deltas, times );
+}
+
+size_t MidiInApi::MidiQueue::pop( unsigned char *bytes, size_t bytesSize, size_t *offsets,
+                                  double *timeStamps, size_t maxMessages, int64_t *monotonicTimes )
+{
+  return popMessages( bytes, bytesSize, offsets, maxMessages, timeStamps, monotonicTimes );
+}
+
+// Create the wake-up descriptor on first use.  Only the consumer thread
+// may call this function.
+int MidiInApi::MidiQueue :: pollDescriptor()
+{
+#if defined(RTMIDI_HAVE_POLL_DESCRIPTOR)
+  if ( notifyFds[0] < 0 ) {
+#if defined(__linux__)
+    int fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+    if ( fd >= 0 ) notifyFds[0] = notifyFds[1] = fd;
+#else
+    int fds[2];
+    if ( pipe( fds ) == 0 ) {
+      for ( int i = 0; i < 2; i++ ) {
+        fcntl( fds[i], F_SETFL, fcntl( fds[i], F_GETFL ) | O_NONBLOCK );
+        fcntl( fds[i], F_SETFD, FD_CLOEXEC );
+      }
+      notifyFds[0] = fds[0];
+      notifyFds[1] = fds[1];
+    }
+#endif
+    if ( notifyFds[0] >= 0 ) {
+      // From now on the producer pays for the fence in notify().  A
+      // push racing with this store may not see it, so signal the
+      // descriptor once: the next arm() checks the queue again.
+      waitable.store( true );
+      uint64_t value = 1;
+      ssize_t result = write( notifyFds[1], &value, sizeof( value ) );
+      (void) result;
+    }
+  }
+  return notifyFds[0];
+#else
+  return -1;
+#endif
+}
+
+// Called by the consumer when it finds the queue empty: clear any
+// pending wake-up and ask the producer to signal the next push.  The
+// queue is checked again afterwards so that a push racing with us is
+// not missed.
+void MidiInApi::MidiQueue :: arm()
+{
+#if defined(RTMIDI_HAVE_POLL_DESCRIPTOR)
+  if ( notifyFds[0] < 0 || armed.load( std::memory_order_relaxed ) ) return;
+
+  uint64_t value;
+  while ( read( notifyFds[0], &value, sizeof( value ) ) > 0 ) {}
+  armed.store( true, std::memory_order_release );
+  std::atomic_thread_fence( std::memory_order_seq_cst );
+  if ( back.load( std::memory_order_relaxed ) != front.load( std::memory_order_relaxed ) )
+    notify();
+#endif
+}
+
+// Signal the wake-up descriptor if the consumer is waiting for it.
+// Nothing can wait before the descriptor exists, which spares the
+// fence when input is read with a callback or by polling getMessage().
+void MidiInApi::MidiQueue :: notify()
+{
+#if defined(RTMIDI_HAVE_POLL_DESCRIPTOR)
+  if ( !waitable.load( std::memory_order_relaxed ) ) return;
+  std::atomic_thread_fence( std::memory_order_seq_cst );
+  if ( armed.load( std::memory_order_relaxed ) &&
+       armed.exchange( false, std::memory_order_acq_rel ) ) {
+    uint64_t value = 1;
+    ssize_t result = write( notifyFds[1], &value, sizeof( value ) );
+    (void) result;
+  }
+#endif
+}
+
+// Wait until the queue is not empty or the timeout (in seconds, or
+// forever if negative) has expired.  Only the consumer thread may call
+// this function.
+bool MidiInApi::MidiQueue :: wait( double timeout )
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  int fd = pollDescriptor();
+
+  while ( size() == 0 ) {
+    int milliseconds = -1;
+    if ( timeout >= 0.0 ) {
+      double left = timeout - std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+      if ( left <= 0.0 ) return false;
+      milliseconds = static_cast<int>( left * 1000.0 ) + 1;
+    }
+
+#if defined(RTMIDI_HAVE_POLL_DESCRIPTOR)
+    if ( fd >= 0 ) {
+      arm();
+      if ( size() > 0 ) break;
+      struct pollfd pfd = { fd, POLLIN, 0 };
+      poll( &pfd, 1, milliseconds );
+      continue;
+    }
+#else
+    (void) fd;
+#endif
+
+    // Without a descriptor, poll the queue every millisecond.
+    (void) milliseconds;
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+  }
+
+  return true;
+}
+
+//*********************************************************************//
+//  Common MidiOutApi Definitions
+//*********************************************************************//
+
+MidiOutApi :: MidiOutApi( void )
+  : MidiApi()
+{
+}
+
+MidiOutApi :: ~MidiOutApi( void )
+{
+}
+
+void MidiOutApi :: sendMessages( const unsigned char *bytes, const size_t *offsets, size_t count )
+{
+  for ( size_t i = 0; i < count; i++ )
+    sendMessage( bytes + offsets[i], offsets[i + 1] - offsets[i] );
+}
+
+void MidiOutApi :: sendMessageAt( int64_t, const unsigned char *message, size_t size )
+{
+  errorString_ = "MidiOutApi::sendMessageAt: the current API cannot schedule messages, sending immediately.";
+  error( RtMidiError::WARNING, errorString_ );
+  sendMessage( message, size );
+}
+
+bool MidiOutApi :: trySendMessage( const unsigned char *message, size_t size )
+{
+  sendMessage( message, size );
+  return true;
+}
+
+void MidiOutApi :: setFlushPolicy( RtMidiOut::FlushPolicy policy, double )
+{
+  if ( policy == RtMidiOut::FLUSH_DEFERRED ) {
+    errorString_ = "MidiOutApi::setFlushPolicy: the current API sends each message immediately.";
+    error( RtMidiError::WARNING, errorString_ );
+  }
+}
+
+void MidiOutApi :: flush( void )
+{
+}
+
+// *************************************************** //
+//
+// OS/API-specific methods.
+//
+// *************************************************** //
+
+#if defined(__MACOSX_CORE__)
+
+// The CoreMIDI API is based on the use of a callback function for
+// MIDI input.  We convert the system specific time stamps to delta
+// time values.
+
+// These are not available on iOS.
+#if (TARGET_OS_IPHONE == 0)
+  #include <CoreAudio/HostTime.h>
+  #include <CoreServices/CoreServices.h>
+#endif
+
+// A structure to hold variables related to the CoreMIDI API
+// implementation.
+struct CoreMidiData {
+  MIDIClientRef client;
+  MIDIPortRef port;
+  MIDIEndpointRef endpoint;
+  MIDIEndpointRef destinationId;
+  unsigned long long lastTime;
+  MIDISysexSendRequest sysexreq;
+};
+
+static MIDIClientRef CoreMidiClientSingleton = 0;
+
+void RtMidi_setCoreMidiClientSingleton(MIDIClientRef client){
+  CoreMidiClientSingleton = client;
+}
+
+void RtMidi_disposeCoreMidiClientSingleton(){
+  if (CoreMidiClientSingleton == 0){
+    return;
+  }
+  MIDIClientDispose( CoreMidiClientSingleton );
   CoreMidiClientSingleton = 0;
 }
 
@@ -1023,7 +1949,7 @@ static void midiInputCallback( const MIDIPacketList *list, void *procRef, void *
 
     // Calculate time stamp.
     if ( data->firstMessage ) {
-      message.timeStamp = 0.0;
+      message.delta = RtMidiIn::Duration( 0 );
       data->firstMessage = false;
     }
     else {
@@ -1034,9 +1960,15 @@ static void midiInputCallback( const MIDIPacketList *list, void *procRef, void *
       time -= apiData->lastTime;
       time = AudioConvertHostTimeToNanos( time );
       if ( !continueSysex )
-        message.timeStamp = time * 0.000000001;
+        message.delta = RtMidiIn::Duration( (int64_t) time );
     }
 
+    // The steady clock is the host clock on macOS, so host times carry
+    // over as absolute times.  Asynchronous SysEx is stamped on receipt.
+    if ( !continueSysex )
+      message.time = RtMidiIn::TimePoint( RtMidiIn::Duration(
+        packet->timeStamp ? (int64_t) AudioConvertHostTimeToNanos( packet->timeStamp ) : 0 ) );
+
     // Track whether any non-filtered messages were found in this
     // packet for timestamp calculation
     bool foundNonFiltered = false;
@@ -1053,15 +1985,7 @@ static void midiInputCallback( const MIDIPacketList *list, void *procRef, void *
 
       if ( !( data->ignoreFlags & 0x01 ) && !continueSysex ) {
         // If not a continuing sysex message, invoke the user callback function or queue the message.
-        if ( data->usingCallback ) {
-          RtMidiIn::RtMidiCallback callback = (RtMidiIn::RtMidiCallback) data->userCallback;
-          callback( message.timeStamp, &message.bytes, data->userData );
-        }
-        else {
-          // As long as we haven't reached our queue size limit, push the message.
-          if ( !data->queue.push( message ) )
-            std::cerr << "\nMidiInCore: message queue limit reached!!\n\n";
-        }
+        data->deliver( message );
         message.bytes.clear();
       }
     }
@@ -1112,18 +2036,10 @@ static void midiInputCallback( const MIDIPacketList *list, void *procRef, void *
           message.bytes.assign( &packet->data[iByte], &packet->data[iByte+size] );
           if ( !continueSysex ) {
             // If not a continuing sysex message, invoke the user callback function or queue the message.
-            if ( data->usingCallback ) {
-              RtMidiIn::RtMidiCallback callback = (RtMidiIn::RtMidiCallback) data->userCallback;
-              callback( message.timeStamp, &message.bytes, data->userData );
-            }
-            else {
-              // As long as we haven't reached our queue size limit, push the message.
-              if ( !data->queue.push( message ) )
-                std::cerr << "\nMidiInCore: message queue limit reached!!\n\n";
-            }
+            data->deliver( message );
             message.bytes.clear();
             // All subsequent messages within same MIDI packet will have time delta 0
-            message.timeStamp = 0.0;
+            message.delta = RtMidiIn::Duration( 0 );
           }
           iByte += size;
         }
@@ -1749,7 +2665,12 @@ void MidiOutCore :: sendMessage( const unsigned char *message, size_t size )
 // preprocessor definition AVOID_TIMESTAMPING to save resources
 // associated with the ALSA sequencer queues.
 
+#include <condition_variable>
+#include <map>
+#include <mutex>
 #include <pthread.h>
+#include <set>
+#include <sys/epoll.h>
 #include <sys/time.h>
 
 // ALSA header file.
@@ -1764,64 +2685,812 @@ struct AlsaMidiData {
   snd_seq_port_subscribe_t *subscription;
   snd_midi_event_t *coder;
   unsigned int bufferSize;
-  unsigned int requestedBufferSize;
-  unsigned char *buffer;
+  std::atomic<unsigned int> inputBufferRequest; // applied by the input thread, see alsaMidiHandler()
+  std::atomic<unsigned long> overruns;
   pthread_t thread;
   pthread_t dummy_thread_id;
   snd_seq_real_time_t lastTime;
   int queue_id; // an input queue is needed to get timestamped events
+  int64_t queueOffset; // monotonic time of the input queue start, in ns
   int trigger_fds[2];
+  bool continueSysex; // SysEx chunks are joined in sysex, see alsaHandleEvent()
+  MidiInApi::MidiMessage sysex;
+  struct AlsaSharedClient *shared; // the client shared in shared client mode, or 0
+  bool portCallback; // a port callback is registered, see alsaWatchPorts()
+  bool threadScheduled; // input thread options, see MidiInAlsa::applyThreadOptions()
+  bool threadPinned;
+  int threadPolicy;
+  int threadPriority;
+  std::vector<unsigned int> threadCpus;
+  std::string threadName;
+  std::mutex outputMutex; // output options and state, see MidiOutAlsa::sendMessages()
+  std::condition_variable flushCondition;
+  std::thread flushThread; // writes out deferred output, see alsaFlushHandler()
+  RtMidiOut::FlushPolicy flushPolicy;
+  std::chrono::steady_clock::duration maxLatency;
+  std::chrono::steady_clock::time_point flushDeadline;
+  bool flushPending; // output is held back until flushDeadline
+  bool stopFlush;
 };
 
 #define PORT_TYPE( pinfo, bits ) ((snd_seq_port_info_get_capability(pinfo) & (bits)) == (bits))
 
-//*********************************************************************//
-//  API: LINUX ALSA
-//  Class Definitions: MidiInAlsa
-//*********************************************************************//
+// Return the monotonic time at which a running queue's real time was
+// zero, reading the queue time between two clock reads.
+static int64_t alsaQueueOffset( snd_seq_t *seq, int queue )
+{
+  snd_seq_queue_status_t *status;
+  snd_seq_queue_status_alloca( &status );
+  int64_t before = RtMidiIn::getMonotonicTime();
+  if ( snd_seq_get_queue_status( seq, queue, status ) < 0 ) return before;
+  int64_t after = RtMidiIn::getMonotonicTime();
+  const snd_seq_real_time_t *time = snd_seq_queue_status_get_real_time( status );
+  return before + ( after - before ) / 2 - ( (int64_t) time->tv_sec * 1000000000 + time->tv_nsec );
+}
+
+// How the sequencer events that carry a single MIDI message translate
+// into MIDI bytes, indexed by event type: the status byte and where
+// the data bytes come from.  Events marked ALSA_DECODE are left to
+// snd_midi_event_decode().
+enum AlsaEventLayout {
+  ALSA_DECODE,   // not handled here
+  ALSA_NOTE,     // status | channel, note, velocity
+  ALSA_CONTROL,  // status | channel, param, value
+  ALSA_VALUE,    // status | channel, value
+  ALSA_BEND,     // status | channel, 14 bit value + 8192
+  ALSA_COMMON,   // status, value
+  ALSA_SONGPOS,  // status, 14 bit value
+  ALSA_STATUS    // status only
+};
 
-static void *alsaMidiHandler( void *ptr )
-{
-  MidiInApi::RtMidiInData *data = static_cast<MidiInApi::RtMidiInData *> (ptr);
-  AlsaMidiData *apiData = static_cast<AlsaMidiData *> (data->apiData);
+struct AlsaEventFormat {
+  unsigned char status;
+  unsigned char layout;
+};
 
-  long nBytes;
-  double time;
-  bool continueSysex = false;
-  bool doDecode = false;
-  MidiInApi::MidiMessage message;
-  int poll_fd_count;
-  struct pollfd *poll_fds;
+static const AlsaEventFormat alsaEventFormats[SND_SEQ_EVENT_SENSING + 1] = {
+  // 0: SYSTEM, RESULT, -, -, -, NOTE, NOTEON, NOTEOFF, KEYPRESS, -
+  { 0, ALSA_DECODE }, { 0, ALSA_DECODE }, { 0, ALSA_DECODE }, { 0, ALSA_DECODE },
+  { 0, ALSA_DECODE }, { 0, ALSA_DECODE }, { 0x90, ALSA_NOTE }, { 0x80, ALSA_NOTE },
+  { 0xA0, ALSA_NOTE }, { 0, ALSA_DECODE },
+  // 10: CONTROLLER, PGMCHANGE, CHANPRESS, PITCHBEND, CONTROL14, NONREGPARAM,
+  //     REGPARAM, -, -, -
+  { 0xB0, ALSA_CONTROL }, { 0xC0, ALSA_VALUE }, { 0xD0, ALSA_VALUE }, { 0xE0, ALSA_BEND },
+  { 0, ALSA_DECODE }, { 0, ALSA_DECODE }, { 0, ALSA_DECODE }, { 0, ALSA_DECODE },
+  { 0, ALSA_DECODE }, { 0, ALSA_DECODE },
+  // 20: SONGPOS, SONGSEL, QFRAME, TIMESIGN, KEYSIGN, -, -, -, -, -
+  { 0xF2, ALSA_SONGPOS }, { 0xF3, ALSA_COMMON }, { 0xF1, ALSA_COMMON }, { 0, ALSA_DECODE },
+  { 0, ALSA_DECODE }, { 0, ALSA_DECODE }, { 0, ALSA_DECODE }, { 0, ALSA_DECODE },
+  { 0, ALSA_DECODE }, { 0, ALSA_DECODE },
+  // 30: START, CONTINUE, STOP, SETPOS_TICK, SETPOS_TIME, TEMPO, CLOCK, TICK,
+  //     QUEUE_SKEW, SYNC_POS
+  { 0xFA, ALSA_STATUS }, { 0xFB, ALSA_STATUS }, { 0xFC, ALSA_STATUS }, { 0, ALSA_DECODE },
+  { 0, ALSA_DECODE }, { 0, ALSA_DECODE }, { 0xF8, ALSA_STATUS }, { 0xF9, ALSA_STATUS },
+  { 0, ALSA_DECODE }, { 0, ALSA_DECODE },
+  // 40: TUNE_REQUEST, RESET, SENSING
+  { 0xF6, ALSA_STATUS }, { 0xFF, ALSA_STATUS }, { 0xFE, ALSA_STATUS }
+};
 
-  snd_seq_event_t *ev;
-  int result;
-  result = snd_midi_event_new( 0, &apiData->coder );
-  if ( result < 0 ) {
-    data->doInput = false;
-    std::cerr << "\nMidiInAlsa::alsaMidiHandler: error initializing MIDI event parser!\n\n";
-    return 0;
-  }
-  unsigned char *buffer = (unsigned char *) malloc( apiData->bufferSize );
-  if ( buffer == NULL ) {
-    data->doInput = false;
-    snd_midi_event_free( apiData->coder );
-    apiData->coder = 0;
-    std::cerr << "\nMidiInAlsa::alsaMidiHandler: error initializing buffer memory!\n\n";
-    return 0;
+// Translate a sequencer event straight into MIDI bytes, with the same
+// result as snd_midi_event_decode() without running status.  Short
+// messages are written to "buffer", which must hold 3 bytes, while a
+// SysEx chunk is returned in place.  Return the number of bytes and
+// point "bytes" at them, or -1 if the event has to go through
+// snd_midi_event_decode().
+static long alsaDecodeEvent( const snd_seq_event_t *ev, unsigned char *buffer,
+                             const unsigned char **bytes )
+{
+  *bytes = buffer;
+  if ( ev->type > SND_SEQ_EVENT_SENSING ) {
+    if ( ev->type != SND_SEQ_EVENT_SYSEX || !snd_seq_ev_is_variable( ev ) ) return -1;
+    *bytes = static_cast<const unsigned char *>( ev->data.ext.ptr );
+    return ev->data.ext.len;
+  }
+
+  const AlsaEventFormat &format = alsaEventFormats[ev->type];
+  int value;
+  switch ( format.layout ) {
+  case ALSA_NOTE:
+    buffer[0] = format.status | ( ev->data.note.channel & 0x0F );
+    buffer[1] = ev->data.note.note & 0x7F;
+    buffer[2] = ev->data.note.velocity & 0x7F;
+    return 3;
+  case ALSA_CONTROL:
+    buffer[0] = format.status | ( ev->data.control.channel & 0x0F );
+    buffer[1] = ev->data.control.param & 0x7F;
+    buffer[2] = ev->data.control.value & 0x7F;
+    return 3;
+  case ALSA_VALUE:
+    buffer[0] = format.status | ( ev->data.control.channel & 0x0F );
+    buffer[1] = ev->data.control.value & 0x7F;
+    return 2;
+  case ALSA_BEND:
+    value = ev->data.control.value + 8192;
+    buffer[0] = format.status | ( ev->data.control.channel & 0x0F );
+    buffer[1] = value & 0x7F;
+    buffer[2] = ( value >> 7 ) & 0x7F;
+    return 3;
+  case ALSA_COMMON:
+    buffer[0] = format.status;
+    buffer[1] = ev->data.control.value & 0x7F;
+    return 2;
+  case ALSA_SONGPOS:
+    value = ev->data.control.value;
+    buffer[0] = format.status;
+    buffer[1] = value & 0x7F;
+    buffer[2] = ( value >> 7 ) & 0x7F;
+    return 3;
+  case ALSA_STATUS:
+    buffer[0] = format.status;
+    return 1;
+  default:
+    return -1;
+  }
+}
+
+// The sequencer event types of each RtMidiIn::MessageType.
+static const struct {
+  unsigned int type;
+  int event;
+} alsaTypeEvents[] = {
+  { RtMidiIn::TYPE_NOTE_OFF, SND_SEQ_EVENT_NOTEOFF },
+  { RtMidiIn::TYPE_NOTE_ON, SND_SEQ_EVENT_NOTEON },
+  { RtMidiIn::TYPE_NOTE_ON, SND_SEQ_EVENT_NOTE },
+  { RtMidiIn::TYPE_KEY_PRESSURE, SND_SEQ_EVENT_KEYPRESS },
+  { RtMidiIn::TYPE_CONTROL_CHANGE, SND_SEQ_EVENT_CONTROLLER },
+  { RtMidiIn::TYPE_CONTROL_CHANGE, SND_SEQ_EVENT_CONTROL14 },
+  { RtMidiIn::TYPE_CONTROL_CHANGE, SND_SEQ_EVENT_NONREGPARAM },
+  { RtMidiIn::TYPE_CONTROL_CHANGE, SND_SEQ_EVENT_REGPARAM },
+  { RtMidiIn::TYPE_PROGRAM_CHANGE, SND_SEQ_EVENT_PGMCHANGE },
+  { RtMidiIn::TYPE_CHANNEL_PRESSURE, SND_SEQ_EVENT_CHANPRESS },
+  { RtMidiIn::TYPE_PITCH_BEND, SND_SEQ_EVENT_PITCHBEND },
+  { RtMidiIn::TYPE_SYSEX, SND_SEQ_EVENT_SYSEX },
+  { RtMidiIn::TYPE_TIME_CODE, SND_SEQ_EVENT_QFRAME },
+  { RtMidiIn::TYPE_SONG_POSITION, SND_SEQ_EVENT_SONGPOS },
+  { RtMidiIn::TYPE_SONG_SELECT, SND_SEQ_EVENT_SONGSEL },
+  { RtMidiIn::TYPE_TUNE_REQUEST, SND_SEQ_EVENT_TUNE_REQUEST },
+  { RtMidiIn::TYPE_CLOCK, SND_SEQ_EVENT_CLOCK },
+  { RtMidiIn::TYPE_TICK, SND_SEQ_EVENT_TICK },
+  { RtMidiIn::TYPE_START, SND_SEQ_EVENT_START },
+  { RtMidiIn::TYPE_CONTINUE, SND_SEQ_EVENT_CONTINUE },
+  { RtMidiIn::TYPE_STOP, SND_SEQ_EVENT_STOP },
+  { RtMidiIn::TYPE_ACTIVE_SENSING, SND_SEQ_EVENT_SENSING },
+  { RtMidiIn::TYPE_SYSTEM_RESET, SND_SEQ_EVENT_RESET }
+};
+
+// Have the sequencer drop the events of the "ignored" message types
+// before they reach the client, so that they do not wake up its input
+// thread.  The client event filter lists the event types that are
+// delivered, so it is set to every other type, in a single call.
+static int alsaSetEventFilter( snd_seq_t *seq, unsigned int ignored )
+{
+  snd_seq_client_info_t *info;
+  snd_seq_client_info_alloca( &info );
+  int result = snd_seq_get_client_info( seq, info );
+  if ( result < 0 ) return result;
+
+  snd_seq_client_info_event_filter_clear( info );
+  if ( ignored ) {
+    bool dropped[256] = { false };
+    for ( size_t i = 0; i < sizeof( alsaTypeEvents ) / sizeof( alsaTypeEvents[0] ); i++ ) {
+      if ( ignored & alsaTypeEvents[i].type ) dropped[alsaTypeEvents[i].event] = true;
+    }
+    for ( int event = 0; event < 256; event++ ) {
+      if ( !dropped[event] ) snd_seq_client_info_event_filter_add( info, event );
+    }
   }
-  snd_midi_event_init( apiData->coder );
-  snd_midi_event_no_status( apiData->coder, 1 ); // suppress running status messages
+  return snd_seq_set_client_info( seq, info );
+}
 
-  poll_fd_count = snd_seq_poll_descriptors_count( apiData->seq, POLLIN ) + 1;
-  poll_fds = (struct pollfd*)alloca( poll_fd_count * sizeof( struct pollfd ));
+// Resize the client's input or output buffer, in bytes, and its
+// sequencer pool, in events.  A size of zero is left unchanged.
+static int alsaSetBufferSize( snd_seq_t *seq, bool input, unsigned int bufferSize,
+                              unsigned int poolSize )
+{
+  int result = 0;
+  if ( bufferSize > 0 ) {
+    result = input ? snd_seq_set_input_buffer_size( seq, bufferSize )
+                   : snd_seq_set_output_buffer_size( seq, bufferSize );
+    if ( result < 0 ) return result;
+  }
+  if ( poolSize > 0 ) {
+    result = input ? snd_seq_set_client_pool_input( seq, poolSize )
+                   : snd_seq_set_client_pool_output( seq, poolSize );
+  }
+  return result;
+}
+
+// Return the number of events the sequencer could not deliver to the
+// client.
+static unsigned long alsaLostEvents( snd_seq_t *seq )
+{
+  snd_seq_client_info_t *cinfo;
+  snd_seq_client_info_alloca( &cinfo );
+  if ( snd_seq_get_client_info( seq, cinfo ) < 0 ) return 0;
+  return (unsigned long) snd_seq_client_info_get_event_lost( cinfo );
+}
+
+// A port listed by RtMidi, see alsaPortInfo().
+struct AlsaPort {
+  int client;
+  int port;
+  std::string name; // "client name:port name client:port"
+};
+
+// A port that appeared or disappeared, to be reported to the port
+// callbacks, see alsaPortHandler().
+struct AlsaPortChange {
+  RtMidi::PortChange change;
+  bool readable;
+  std::string name;
+};
+
+struct AlsaPortWatcher {
+  const MidiApi *api;
+  bool readable;  // whether the instance lists the readable ports
+  RtMidi::RtMidiPortCallback callback;
+  void *userData;
+};
+
+// The ports of the system.  While MidiInAlsa or MidiOutAlsa instances
+// exist, a client subscribed to the System:Announce port learns when
+// clients and ports come, go or change, and the table is only rebuilt
+// on the next lookup after such an announcement.  While port callbacks
+// are set, a thread waits for the announcements and reports the ports
+// that changed.
+struct AlsaPortTable {
+  snd_seq_t *seq;     // the announcement client, or 0 if there is none
+  unsigned int users;
+  bool valid;
+  std::vector<AlsaPort> readable; // the ports MidiInAlsa connects from
+  std::vector<AlsaPort> writable; // the ports MidiOutAlsa connects to
+  bool watching;      // changes are collected for the port thread
+  std::vector<AlsaPortChange> changes;
+  std::mutex dispatchMutex; // guards watchers, calling and handler
+  std::vector<AlsaPortWatcher> watchers;
+  const MidiApi *calling;   // the instance whose callback runs, or 0
+  std::condition_variable called; // signalled when a callback returns
+  std::thread::id handler;  // the port thread, which may not wait for itself
+  std::atomic<bool> running;
+  std::thread thread;
+  int wake_fd;        // an eventfd that wakes the port thread
+  bool orphaned;      // released from a callback, the port thread deletes it
+};
+
+static std::mutex alsaPortMutex;  // guards alsaPorts and the table, but for the watchers
+static std::mutex alsaWatchMutex; // serializes starting and stopping the port thread
+static AlsaPortTable *alsaPorts = 0;
+
+static void alsaAcquirePorts( void )
+{
+  std::lock_guard<std::mutex> lock( alsaPortMutex );
+  if ( alsaPorts ) {
+    alsaPorts->users++;
+    return;
+  }
+
+  AlsaPortTable *table = new AlsaPortTable;
+  table->seq = 0;
+  table->users = 1;
+  table->valid = false;
+  table->watching = false;
+  table->calling = 0;
+  table->running = false;
+  table->wake_fd = -1;
+  table->orphaned = false;
+
+  // Without announcements, the table is rebuilt on every lookup.
+  snd_seq_t *seq;
+  if ( snd_seq_open( &seq, "default", SND_SEQ_OPEN_INPUT, SND_SEQ_NONBLOCK ) >= 0 ) {
+    snd_seq_set_client_name( seq, "RtMidi Port Monitor" );
+    int port = snd_seq_create_simple_port( seq, "Announcements",
+                                           SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_NO_EXPORT,
+                                           SND_SEQ_PORT_TYPE_APPLICATION );
+    if ( port >= 0 &&
+         snd_seq_connect_from( seq, port, SND_SEQ_CLIENT_SYSTEM, SND_SEQ_PORT_SYSTEM_ANNOUNCE ) >= 0 )
+      table->seq = seq;
+    else
+      snd_seq_close( seq );
+  }
+  alsaPorts = table;
+}
+
+static bool alsaOnPortThread( AlsaPortTable *table )
+{
+  std::lock_guard<std::mutex> lock( table->dispatchMutex );
+  return table->running && table->handler == std::this_thread::get_id();
+}
+
+// Stop the port thread from another thread.
+static void alsaStopPortThread( AlsaPortTable *table )
+{
+  {
+    std::lock_guard<std::mutex> lock( alsaPortMutex );
+    table->watching = false;
+    table->changes.clear();
+  }
+  table->running = false;
+  uint64_t value = 1;
+  ssize_t res = write( table->wake_fd, &value, sizeof( value ) );
+  (void) res;
+  table->thread.join();
+  close( table->wake_fd );
+  table->wake_fd = -1;
+}
+
+static void alsaReleasePorts( void )
+{
+  AlsaPortTable *table;
+  {
+    std::lock_guard<std::mutex> lock( alsaPortMutex );
+    if ( !alsaPorts || --alsaPorts->users > 0 ) return;
+    table = alsaPorts;
+    alsaPorts = 0;
+  }
+
+  {
+    std::lock_guard<std::mutex> watchLock( alsaWatchMutex );
+    if ( table->running ) {
+      if ( alsaOnPortThread( table ) ) {
+        // The last instance was deleted from a port callback: the thread
+        // ends and deletes the table once the callback returns.
+        table->running = false;
+        table->orphaned = true;
+        table->thread.detach();
+        return;
+      }
+      alsaStopPortThread( table );
+    }
+  }
+  if ( table->seq ) snd_seq_close( table->seq );
+  delete table;
+}
+
+// List the MIDI ports that other clients export.
+static void alsaScanPorts( snd_seq_t *seq, AlsaPortTable *table )
+{
+  snd_seq_client_info_t *cinfo;
+  snd_seq_port_info_t *pinfo;
+  snd_seq_client_info_alloca( &cinfo );
+  snd_seq_port_info_alloca( &pinfo );
+
+  table->readable.clear();
+  table->writable.clear();
+  snd_seq_client_info_set_client( cinfo, -1 );
+  while ( snd_seq_query_next_client( seq, cinfo ) >= 0 ) {
+    int client = snd_seq_client_info_get_client( cinfo );
+    if ( client == 0 ) continue;
+    std::string clientName = snd_seq_client_info_get_name( cinfo );
+    // Reset query info
+    snd_seq_port_info_set_client( pinfo, client );
+    snd_seq_port_info_set_port( pinfo, -1 );
+    while ( snd_seq_query_next_port( seq, pinfo ) >= 0 ) {
+      unsigned int atyp = snd_seq_port_info_get_type( pinfo );
+      if ( ( ( atyp & SND_SEQ_PORT_TYPE_MIDI_GENERIC ) == 0 ) &&
+           ( ( atyp & SND_SEQ_PORT_TYPE_SYNTH ) == 0 ) &&
+           ( ( atyp & SND_SEQ_PORT_TYPE_APPLICATION ) == 0 ) ) continue;
+
+      unsigned int caps = snd_seq_port_info_get_capability( pinfo );
+      if ( ( caps & SND_SEQ_PORT_CAP_NO_EXPORT ) != 0 ) continue;
+
+      AlsaPort port;
+      port.client = client;
+      port.port = snd_seq_port_info_get_port( pinfo );
+      // The client and port numbers keep identical device names apart.
+      port.name = clientName + ":" + snd_seq_port_info_get_name( pinfo ) + " " +
+        std::to_string( port.client ) + ":" + std::to_string( port.port );
+      const unsigned int read = SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ;
+      const unsigned int write = SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE;
+      if ( ( caps & read ) == read ) table->readable.push_back( port );
+      if ( ( caps & write ) == write ) table->writable.push_back( port );
+    }
+  }
+}
+
+// Collect the ports in "after" but not in "before" as added, and the
+// other way around as removed.  A renamed port is both.
+static void alsaDiffPorts( const std::vector<AlsaPort> &before, const std::vector<AlsaPort> &after,
+                           bool readable, std::vector<AlsaPortChange> &changes )
+{
+  std::set<std::string> beforeNames, afterNames;
+  for ( size_t i = 0; i < before.size(); i++ ) beforeNames.insert( before[i].name );
+  for ( size_t i = 0; i < after.size(); i++ ) afterNames.insert( after[i].name );
+
+  AlsaPortChange change;
+  change.readable = readable;
+  change.change = RtMidi::PORT_REMOVED;
+  for ( size_t i = 0; i < before.size(); i++ ) {
+    if ( afterNames.count( before[i].name ) ) continue;
+    change.name = before[i].name;
+    changes.push_back( change );
+  }
+  change.change = RtMidi::PORT_ADDED;
+  for ( size_t i = 0; i < after.size(); i++ ) {
+    if ( beforeNames.count( after[i].name ) ) continue;
+    change.name = after[i].name;
+    changes.push_back( change );
+  }
+}
+
+// Rebuild the table if an announcement, or lost ones, made it stale,
+// and hand what changed to the port thread.  The caller holds
+// alsaPortMutex.
+static void alsaUpdatePorts( snd_seq_t *seq, AlsaPortTable *table )
+{
+  bool stale = !table->valid;
+  if ( table->seq ) {
+    snd_seq_event_t *ev;
+    int result;
+    while ( ( result = snd_seq_event_input( table->seq, &ev ) ) != -EAGAIN ) {
+      stale = true;
+      if ( result < 0 && result != -ENOSPC ) break;
+    }
+  }
+  if ( !stale ) return;
+
+  if ( table->watching && table->valid ) {
+    std::vector<AlsaPort> readable, writable;
+    readable.swap( table->readable );
+    writable.swap( table->writable );
+    alsaScanPorts( table->seq, table );
+    size_t count = table->changes.size();
+    alsaDiffPorts( readable, table->readable, true, table->changes );
+    alsaDiffPorts( writable, table->writable, false, table->changes );
+    if ( table->changes.size() > count ) {
+      uint64_t value = 1;
+      ssize_t res = write( table->wake_fd, &value, sizeof( value ) );
+      (void) res;
+    }
+  }
+  else
+    alsaScanPorts( table->seq ? table->seq : seq, table );
+  table->valid = table->seq != 0;
+}
+
+// Count the ports with the capabilities in type if portNumber is
+// negative, or else look up the port with that index.  Returns 1 if
+// it exists and 0 if not.
+static unsigned int alsaPortInfo( snd_seq_t *seq, unsigned int type, int portNumber, AlsaPort *port = 0 )
+{
+  std::lock_guard<std::mutex> lock( alsaPortMutex );
+  AlsaPortTable scratch;
+  AlsaPortTable *table = alsaPorts;
+  if ( !table ) {
+    table = &scratch;
+    table->seq = 0;
+    table->valid = false;
+    table->watching = false;
+  }
+  alsaUpdatePorts( seq, table );
+
+  const std::vector<AlsaPort> &ports = ( type & SND_SEQ_PORT_CAP_READ ) ? table->readable : table->writable;
+  if ( portNumber < 0 ) return (unsigned int) ports.size();
+  if ( (size_t) portNumber >= ports.size() ) return 0;
+  if ( port ) *port = ports[portNumber];
+  return 1;
+}
+
+static bool alsaIsWatching( const AlsaPortTable *table, const AlsaPortWatcher &watcher )
+{
+  for ( size_t i = 0; i < table->watchers.size(); i++ ) {
+    const AlsaPortWatcher &w = table->watchers[i];
+    if ( w.api == watcher.api && w.callback == watcher.callback && w.userData == watcher.userData )
+      return true;
+  }
+  return false;
+}
+
+// Report the port changes collected by alsaUpdatePorts() to the port
+// callbacks, woken by announcements and by lookups that found changes.
+// The callbacks run without the locks, so that they can create and
+// delete instances; alsaWatchPorts() waits for a running callback of
+// the instance it removes.
+static void alsaPortHandler( AlsaPortTable *table )
+{
+  int count = snd_seq_poll_descriptors_count( table->seq, POLLIN ) + 1;
+  std::vector<struct pollfd> fds( count );
+  fds[0].fd = table->wake_fd;
+  fds[0].events = POLLIN;
+  snd_seq_poll_descriptors( table->seq, &fds[1], count - 1, POLLIN );
+
+  std::vector<AlsaPortChange> changes;
+  std::vector<AlsaPortWatcher> watchers;
+  {
+    std::lock_guard<std::mutex> lock( table->dispatchMutex );
+    table->handler = std::this_thread::get_id();
+  }
+  while ( table->running ) {
+    {
+      std::lock_guard<std::mutex> lock( alsaPortMutex );
+      alsaUpdatePorts( table->seq, table );
+      changes.swap( table->changes );
+    }
+    if ( !changes.empty() ) {
+      std::unique_lock<std::mutex> lock( table->dispatchMutex );
+      watchers = table->watchers;
+      for ( size_t i = 0; i < changes.size(); i++ ) {
+        for ( size_t j = 0; j < watchers.size(); j++ ) {
+          const AlsaPortWatcher &watcher = watchers[j];
+          // Skip the callbacks removed by an earlier callback.
+          if ( watcher.readable != changes[i].readable || !alsaIsWatching( table, watcher ) ) continue;
+          table->calling = watcher.api;
+          lock.unlock();
+          watcher.callback( changes[i].change, changes[i].name, watcher.userData );
+          lock.lock();
+          table->calling = 0;
+          table->called.notify_all();
+        }
+      }
+    }
+    changes.clear();
+    if ( !table->running ) break;
+
+    if ( poll( fds.data(), count, -1 ) > 0 && ( fds[0].revents & POLLIN ) ) {
+      uint64_t value;
+      ssize_t res = read( fds[0].fd, &value, sizeof( value ) );
+      (void) res;
+    }
+  }
+
+  if ( table->orphaned ) {
+    close( fds[0].fd );
+    if ( table->seq ) snd_seq_close( table->seq );
+    delete table;
+  }
+}
+
+// Set, replace or, with a NULL callback, remove the port callback of an
+// instance, and start or stop the port thread as needed.  Returns false
+// if announcements are not available.  Called from a port callback, the
+// thread is left running for the remaining or later watchers, and it
+// ends with the table.
+static bool alsaWatchPorts( const MidiApi *api, bool readable,
+                            RtMidi::RtMidiPortCallback callback, void *userData )
+{
+  AlsaPortTable *table;
+  {
+    std::lock_guard<std::mutex> lock( alsaPortMutex );
+    table = alsaPorts;
+  }
+  if ( !table || !table->seq ) return !callback;
+
+  {
+    // Once this returns, the old callback is no longer called, which
+    // waits for it to return unless it is the caller.
+    std::unique_lock<std::mutex> lock( table->dispatchMutex );
+    std::vector<AlsaPortWatcher>::iterator it = table->watchers.begin();
+    while ( it != table->watchers.end() && it->api != api ) ++it;
+    if ( it != table->watchers.end() ) table->watchers.erase( it );
+    while ( table->calling == api && table->handler != std::this_thread::get_id() )
+      table->called.wait( lock );
+    if ( callback ) {
+      AlsaPortWatcher watcher = { api, readable, callback, userData };
+      table->watchers.push_back( watcher );
+    }
+  }
+
+  std::lock_guard<std::mutex> watchLock( alsaWatchMutex );
+  bool idle;
+  {
+    std::lock_guard<std::mutex> lock( table->dispatchMutex );
+    idle = table->watchers.empty();
+  }
+  if ( !idle && !table->running ) {
+    table->wake_fd = eventfd( 0, 0 );
+    if ( table->wake_fd < 0 ) {
+      std::lock_guard<std::mutex> lock( table->dispatchMutex );
+      table->watchers.clear();
+      return false;
+    }
+    {
+      // Changes are reported from the current list on.
+      std::lock_guard<std::mutex> lock( alsaPortMutex );
+      alsaUpdatePorts( table->seq, table );
+      table->changes.clear();
+      table->watching = true;
+    }
+    table->running = true;
+    table->thread = std::thread( alsaPortHandler, table );
+  }
+  else if ( idle && table->running && !alsaOnPortThread( table ) )
+    alsaStopPortThread( table );
+  return true;
+}
+
+//*********************************************************************//
+//  API: LINUX ALSA
+//  Class Definitions: MidiInAlsa
+//*********************************************************************//
+
+// Translate a sequencer event received for an input port and deliver
+// the MIDI message it completes, if any.  The events that have to go
+// through snd_midi_event_decode() are decoded with "coder" into
+// "buffer".
+static void alsaHandleEvent( MidiInApi::RtMidiInData *data, snd_seq_event_t *ev, snd_midi_event_t *coder,
+                             unsigned char *buffer, unsigned int bufferSize )
+{
+  AlsaMidiData *apiData = static_cast<AlsaMidiData *> (data->apiData);
+
+  long nBytes;
+  bool doDecode = false;
+  unsigned char shortMessage[3];
+  const unsigned char *chunk;
+  const unsigned char *bytes;
+  size_t size;
+  RtMidiIn::Duration delta( 0 );
+  RtMidiIn::TimePoint time;
+
+  // This is a bit weird, but we now have to decode an ALSA MIDI
+  // event (back) into MIDI bytes.  We'll ignore non-MIDI types.
+  if ( !apiData->continueSysex ) apiData->sysex.bytes.clear();
+
+  bytes = 0;
+  size = 0;
+  doDecode = false;
+  switch ( ev->type ) {
+
+  case SND_SEQ_EVENT_PORT_SUBSCRIBED:
+#if defined(__RTMIDI_DEBUG__)
+    std::cout << "MidiInAlsa::alsaMidiHandler: port connection made!\n";
+#endif
+    break;
+
+  case SND_SEQ_EVENT_PORT_UNSUBSCRIBED:
+#if defined(__RTMIDI_DEBUG__)
+    std::cerr << "MidiInAlsa::alsaMidiHandler: port connection has closed!\n";
+    std::cout << "sender = " << (int) ev->data.connect.sender.client << ":"
+              << (int) ev->data.connect.sender.port
+              << ", dest = " << (int) ev->data.connect.dest.client << ":"
+              << (int) ev->data.connect.dest.port
+              << std::endl;
+#endif
+    break;
+
+  case SND_SEQ_EVENT_QFRAME: // MIDI time code
+    if ( !( data->ignoreFlags & 0x02 ) ) doDecode = true;
+    break;
+
+  case SND_SEQ_EVENT_TICK: // 0xF9 ... MIDI timing tick
+    if ( !( data->ignoreFlags & 0x02 ) ) doDecode = true;
+    break;
+
+  case SND_SEQ_EVENT_CLOCK: // 0xF8 ... MIDI timing (clock) tick
+    if ( !( data->ignoreFlags & 0x02 ) ) doDecode = true;
+    break;
+
+  case SND_SEQ_EVENT_SENSING: // Active sensing
+    if ( !( data->ignoreFlags & 0x04 ) ) doDecode = true;
+    break;
+
+  case SND_SEQ_EVENT_SYSEX:
+    if ( !( data->ignoreFlags & 0x01 ) ) doDecode = true;
+    break;
+
+  default:
+    doDecode = true;
+  }
+
+  if ( doDecode ) {
+
+    // Channel voice, system and SysEx events are translated
+    // directly, anything else goes through the generic decoder.
+    nBytes = alsaDecodeEvent( ev, shortMessage, &chunk );
+    if ( nBytes < 0 ) {
+      chunk = buffer;
+      nBytes = snd_midi_event_decode( coder, buffer, bufferSize, ev );
+    }
+    if ( nBytes > 0 ) {
+      // The ALSA sequencer has a maximum buffer size for MIDI sysex
+      // events of 256 bytes.  If a device sends sysex messages larger
+      // than this, they are segmented into 256 byte chunks.  So,
+      // we'll watch for this and concatenate sysex chunks into a
+      // single sysex message if necessary.  Complete messages are
+      // delivered straight from the decoded chunk.
+      bool lastChunk = ( ev->type != SND_SEQ_EVENT_SYSEX ) || ( chunk[nBytes - 1] == 0xF7 );
+      if ( !apiData->continueSysex && lastChunk ) {
+        bytes = chunk;
+        size = nBytes;
+      }
+      else {
+        apiData->sysex.bytes.insert( apiData->sysex.bytes.end(), chunk, &chunk[nBytes] );
+        if ( lastChunk ) {
+          bytes = apiData->sysex.bytes.data();
+          size = apiData->sysex.bytes.size();
+        }
+      }
+
+      apiData->continueSysex = !lastChunk;
+      if ( !apiData->continueSysex ) {
+
+        // Calculate the time stamp:
+
+        // Method 1: Use the system time.
+        //(void)gettimeofday(&tv, (struct timezone *)NULL);
+        //time = (tv.tv_sec * 1000000) + tv.tv_usec;
+
+        // Method 2: Use the ALSA sequencer event time data.
+        // (thanks to Pedro Lopez-Cabanillas!).
+
+        // The event time has unsigned seconds and nanoseconds, so the
+        // difference is taken in signed integer nanoseconds.
+        snd_seq_real_time_t &x( ev->time.time );
+        int64_t eventTime = (int64_t) x.tv_sec * 1000000000 + x.tv_nsec;
+        int64_t lastTime = (int64_t) apiData->lastTime.tv_sec * 1000000000 + apiData->lastTime.tv_nsec;
+
+        apiData->lastTime = ev->time.time;
+
+        // The absolute time of the event on the monotonic clock.
+#ifndef AVOID_TIMESTAMPING
+        time = RtMidiIn::TimePoint( RtMidiIn::Duration( apiData->queueOffset + eventTime ) );
+#else
+        time = RtMidiIn::Clock::now();
+#endif
+
+        if ( data->firstMessage == true )
+          data->firstMessage = false;
+        else
+          delta = RtMidiIn::Duration( eventTime - lastTime );
+      }
+      else {
+#if defined(__RTMIDI_DEBUG__)
+        std::cerr << "\nMidiInAlsa::alsaMidiHandler: event parsing error or not a MIDI event!\n\n";
+#endif
+      }
+    }
+  }
+
+  // A SysEx chunk is delivered from the event itself, which stays
+  // valid until the next call to snd_seq_event_input().
+  if ( size > 0 && !apiData->continueSysex )
+    data->deliver( bytes, size, delta, time );
+}
+
+static void *alsaMidiHandler( void *ptr )
+{
+  MidiInApi::RtMidiInData *data = static_cast<MidiInApi::RtMidiInData *> (ptr);
+  AlsaMidiData *apiData = static_cast<AlsaMidiData *> (data->apiData);
+
+  int poll_fd_count;
+  struct pollfd *poll_fds;
+
+  snd_seq_event_t *ev;
+  int result;
+  result = snd_midi_event_new( 0, &apiData->coder );
+  if ( result < 0 ) {
+    data->doInput = false;
+    std::cerr << "\nMidiInAlsa::alsaMidiHandler: error initializing MIDI event parser!\n\n";
+    return 0;
+  }
+  unsigned char *buffer = (unsigned char *) malloc( apiData->bufferSize );
+  if ( buffer == NULL ) {
+    data->doInput = false;
+    snd_midi_event_free( apiData->coder );
+    apiData->coder = 0;
+    std::cerr << "\nMidiInAlsa::alsaMidiHandler: error initializing buffer memory!\n\n";
+    return 0;
+  }
+  snd_midi_event_init( apiData->coder );
+  snd_midi_event_no_status( apiData->coder, 1 ); // suppress running status messages
+
+  poll_fd_count = snd_seq_poll_descriptors_count( apiData->seq, POLLIN ) + 1;
+  poll_fds = (struct pollfd*)alloca( poll_fd_count * sizeof( struct pollfd ));
   snd_seq_poll_descriptors( apiData->seq, poll_fds + 1, poll_fd_count - 1, POLLIN );
   poll_fds[0].fd = apiData->trigger_fds[0];
   poll_fds[0].events = POLLIN;
 
+  // Each wakeup handles every event pending in the sequencer, and a
+  // batch callback receives them all at once.
+  data->batching = true;
+  apiData->continueSysex = false;
+
   while ( data->doInput ) {
 
-    if ( snd_seq_event_input_pending( apiData->seq, 1 ) == 0 ) {
+    // Events are read from the input buffer, which is refilled from
+    // the sequencer in one system call once it is empty.
+    result = snd_seq_event_input_pending( apiData->seq, 1 );
+    if ( result == 0 || result == -EAGAIN ) {
       // No data pending
+      data->flushBatch();
       if ( poll( poll_fds, poll_fd_count, -1) >= 0 ) {
         if ( poll_fds[0].revents & POLLIN ) {
           bool dummy;
@@ -1829,13 +3498,23 @@ static void *alsaMidiHandler( void *ptr )
           (void) res;
         }
       }
+
+      // The input buffer is only resized here, while no event is held.
+      unsigned int size = apiData->inputBufferRequest.exchange( 0 );
+      if ( size > 0 && snd_seq_set_input_buffer_size( apiData->seq, size ) < 0 )
+        std::cerr << "\nMidiInAlsa::alsaMidiHandler: error resizing the input buffer!\n\n";
       continue;
     }
 
     // If here, there should be data.
     result = snd_seq_event_input( apiData->seq, &ev );
     if ( result == -ENOSPC ) {
-      std::cerr << "\nMidiInAlsa::alsaMidiHandler: MIDI input buffer overrun!\n\n";
+      // The sequencer dropped the events in the pool, which may have
+      // cut a SysEx short.  Overruns are only counted, for
+      // getOverrunCount(): printing each would slow the thread down
+      // just when it falls behind.
+      apiData->overruns++;
+      apiData->continueSysex = false;
       continue;
     }
     else if ( result <= 0 ) {
@@ -1844,150 +3523,236 @@ static void *alsaMidiHandler( void *ptr )
       continue;
     }
 
-    // This is a bit weird, but we now have to decode an ALSA MIDI
-    // event (back) into MIDI bytes.  We'll ignore non-MIDI types.
-    if ( !continueSysex ) message.bytes.clear();
-
-    doDecode = false;
-    switch ( ev->type ) {
-
-    case SND_SEQ_EVENT_PORT_SUBSCRIBED:
-#if defined(__RTMIDI_DEBUG__)
-      std::cout << "MidiInAlsa::alsaMidiHandler: port connection made!\n";
-#endif
-      break;
-
-    case SND_SEQ_EVENT_PORT_UNSUBSCRIBED:
-#if defined(__RTMIDI_DEBUG__)
-      std::cerr << "MidiInAlsa::alsaMidiHandler: port connection has closed!\n";
-      std::cout << "sender = " << (int) ev->data.connect.sender.client << ":"
-                << (int) ev->data.connect.sender.port
-                << ", dest = " << (int) ev->data.connect.dest.client << ":"
-                << (int) ev->data.connect.dest.port
-                << std::endl;
-#endif
-      break;
+    alsaHandleEvent( data, ev, apiData->coder, buffer, apiData->bufferSize );
+    snd_seq_free_event( ev );
+  }
 
-    case SND_SEQ_EVENT_QFRAME: // MIDI time code
-      if ( !( data->ignoreFlags & 0x02 ) ) doDecode = true;
-      break;
+  data->flushBatch();
+  data->batching = false;
+  if ( buffer ) free( buffer );
+  snd_midi_event_free( apiData->coder );
+  apiData->coder = 0;
+  apiData->thread = apiData->dummy_thread_id;
+  return 0;
+}
 
-    case SND_SEQ_EVENT_TICK: // 0xF9 ... MIDI timing tick
-      if ( !( data->ignoreFlags & 0x02 ) ) doDecode = true;
-      break;
+// The sequencer client shared by the MidiInAlsa instances created in
+// shared client mode (see RtMidi::setSharedClient()).  Each instance
+// has its own port on the client, and a single dispatcher thread
+// routes incoming events to the instances by destination port.
+struct AlsaSharedClient {
+  snd_seq_t *seq;
+  int queue_id;
+  int64_t queueOffset;
+  int epoll_fd;
+  int wake_fd;        // an eventfd that stops the dispatcher
+  std::atomic<bool> running;
+  pthread_t thread;
+  unsigned int users; // guarded by alsaSharedMutex
+  std::mutex mutex;   // guards ports, held while events are delivered
+  std::map<int, MidiInApi::RtMidiInData *> ports;
+};
 
-    case SND_SEQ_EVENT_CLOCK: // 0xF8 ... MIDI timing (clock) tick
-      if ( !( data->ignoreFlags & 0x02 ) ) doDecode = true;
-      break;
+static std::mutex alsaSharedMutex;
+static AlsaSharedClient *alsaShared = 0;
 
-    case SND_SEQ_EVENT_SENSING: // Active sensing
-      if ( !( data->ignoreFlags & 0x04 ) ) doDecode = true;
-      break;
+static void *alsaSharedHandler( void *ptr )
+{
+  AlsaSharedClient *shared = static_cast<AlsaSharedClient *> (ptr);
+  snd_midi_event_t *coder;
+  if ( snd_midi_event_new( 0, &coder ) < 0 ) {
+    std::cerr << "\nMidiInAlsa::alsaSharedHandler: error initializing MIDI event parser!\n\n";
+    return 0;
+  }
+  snd_midi_event_init( coder );
+  snd_midi_event_no_status( coder, 1 ); // suppress running status messages
+  unsigned char buffer[256];
 
-    case SND_SEQ_EVENT_SYSEX:
-      if ( (data->ignoreFlags & 0x01) ) break;
-      if ( ev->data.ext.len > apiData->bufferSize ) {
-        apiData->bufferSize = ev->data.ext.len;
-        free( buffer );
-        buffer = (unsigned char *) malloc( apiData->bufferSize );
-        if ( buffer == NULL ) {
-          data->doInput = false;
-          std::cerr << "\nMidiInAlsa::alsaMidiHandler: error resizing buffer memory!\n\n";
+  struct epoll_event events[8];
+  snd_seq_event_t *ev;
+  while ( shared->running ) {
+    {
+      std::lock_guard<std::mutex> lock( shared->mutex );
+      for ( ;; ) {
+        int result = snd_seq_event_input_pending( shared->seq, 1 );
+        if ( result == 0 || result == -EAGAIN ) break;
+        result = snd_seq_event_input( shared->seq, &ev );
+        if ( result == -ENOSPC ) {
+          // The events dropped may have been for any port.
+          std::map<int, MidiInApi::RtMidiInData *>::iterator port;
+          for ( port = shared->ports.begin(); port != shared->ports.end(); ++port ) {
+            AlsaMidiData *apiData = static_cast<AlsaMidiData *> (port->second->apiData);
+            apiData->overruns++;
+            apiData->continueSysex = false;
+          }
+          continue;
+        }
+        else if ( result <= 0 ) {
+          std::cerr << "\nMidiInAlsa::alsaSharedHandler: unknown MIDI input error!\n";
+          perror("System reports");
           break;
         }
+
+        std::map<int, MidiInApi::RtMidiInData *>::iterator port = shared->ports.find( ev->dest.port );
+        if ( port != shared->ports.end() )
+          alsaHandleEvent( port->second, ev, coder, buffer, sizeof( buffer ) );
+        snd_seq_free_event( ev );
       }
-      doDecode = true;
-      break;
 
-    default:
-      doDecode = true;
+      // A batch callback receives all events of a wakeup at once.
+      std::map<int, MidiInApi::RtMidiInData *>::iterator port;
+      for ( port = shared->ports.begin(); port != shared->ports.end(); ++port )
+        port->second->flushBatch();
     }
 
-    if ( doDecode ) {
-
-      nBytes = snd_midi_event_decode( apiData->coder, buffer, apiData->bufferSize, ev );
-      if ( nBytes > 0 ) {
-        // The ALSA sequencer has a maximum buffer size for MIDI sysex
-        // events of 256 bytes.  If a device sends sysex messages larger
-        // than this, they are segmented into 256 byte chunks.  So,
-        // we'll watch for this and concatenate sysex chunks into a
-        // single sysex message if necessary.
-        if ( !continueSysex )
-          message.bytes.assign( buffer, &buffer[nBytes] );
-        else
-          message.bytes.insert( message.bytes.end(), buffer, &buffer[nBytes] );
-
-        continueSysex = ( ( ev->type == SND_SEQ_EVENT_SYSEX ) && ( message.bytes.back() != 0xF7 ) );
-        if ( !continueSysex ) {
-
-          // Calculate the time stamp:
-          message.timeStamp = 0.0;
-
-          // Method 1: Use the system time.
-          //(void)gettimeofday(&tv, (struct timezone *)NULL);
-          //time = (tv.tv_sec * 1000000) + tv.tv_usec;
-
-          // Method 2: Use the ALSA sequencer event time data.
-          // (thanks to Pedro Lopez-Cabanillas!).
-
-          // Using method from:
-          // https://www.gnu.org/software/libc/manual/html_node/Elapsed-Time.html
-
-          // Perform the carry for the later subtraction by updating y.
-          // Temp var y is timespec because computation requires signed types,
-          // while snd_seq_real_time_t has unsigned types.
-          snd_seq_real_time_t &x( ev->time.time );
-          struct timespec y;
-          y.tv_nsec = apiData->lastTime.tv_nsec;
-          y.tv_sec = apiData->lastTime.tv_sec;
-          if ( x.tv_nsec < y.tv_nsec ) {
-              int nsec = (y.tv_nsec - (int)x.tv_nsec) / 1000000000 + 1;
-              y.tv_nsec -= 1000000000 * nsec;
-              y.tv_sec += nsec;
-          }
-          if ( x.tv_nsec - y.tv_nsec > 1000000000 ) {
-              int nsec = ((int)x.tv_nsec - y.tv_nsec) / 1000000000;
-              y.tv_nsec += 1000000000 * nsec;
-              y.tv_sec -= nsec;
-          }
+    int count = epoll_wait( shared->epoll_fd, events, 8, -1 );
+    for ( int i = 0; i < count; i++ ) {
+      if ( events[i].data.fd == shared->wake_fd ) {
+        uint64_t value;
+        ssize_t res = read( shared->wake_fd, &value, sizeof( value ) );
+        (void) res;
+      }
+    }
+  }
 
-          // Compute the time difference.
-          time = (int)x.tv_sec - y.tv_sec + ((int)x.tv_nsec - y.tv_nsec)*1e-9;
+  snd_midi_event_free( coder );
+  return 0;
+}
 
-          apiData->lastTime = ev->time.time;
+// Filter out the message types that every routed instance ignores.
+// The caller holds the shared client's mutex.
+static int alsaFilterShared( AlsaSharedClient *shared )
+{
+  unsigned int ignored = ~0u;
+  std::map<int, MidiInApi::RtMidiInData *>::iterator port;
+  for ( port = shared->ports.begin(); port != shared->ports.end(); ++port )
+    ignored &= port->second->ignoredTypes;
+  return alsaSetEventFilter( shared->seq, ignored );
+}
 
-          if ( data->firstMessage == true )
-            data->firstMessage = false;
-          else
-            message.timeStamp = time;
-        }
-        else {
-#if defined(__RTMIDI_DEBUG__)
-          std::cerr << "\nMidiInAlsa::alsaMidiHandler: event parsing error or not a MIDI event!\n\n";
+static void alsaCloseShared( AlsaSharedClient *shared )
+{
+  if ( shared->epoll_fd >= 0 ) close( shared->epoll_fd );
+  if ( shared->wake_fd >= 0 ) close( shared->wake_fd );
+#ifndef AVOID_TIMESTAMPING
+  if ( shared->queue_id >= 0 ) snd_seq_free_queue( shared->seq, shared->queue_id );
 #endif
-        }
-      }
-    }
+  snd_seq_close( shared->seq );
+  delete shared;
+}
 
-    snd_seq_free_event( ev );
-    if ( message.bytes.size() == 0 || continueSysex ) continue;
+// Return the shared client, creating it and starting its dispatcher
+// thread for the first user, or 0 on failure.
+static AlsaSharedClient *alsaAcquireShared( const std::string &clientName )
+{
+  std::lock_guard<std::mutex> lock( alsaSharedMutex );
+  if ( alsaShared ) {
+    alsaShared->users++;
+    return alsaShared;
+  }
 
-    if ( data->usingCallback ) {
-      RtMidiIn::RtMidiCallback callback = (RtMidiIn::RtMidiCallback) data->userCallback;
-      callback( message.timeStamp, &message.bytes, data->userData );
-    }
-    else {
-      // As long as we haven't reached our queue size limit, push the message.
-      if ( !data->queue.push( message ) )
-        std::cerr << "\nMidiInAlsa: message queue limit reached!!\n\n";
-    }
+  snd_seq_t *seq;
+  if ( snd_seq_open( &seq, "default", SND_SEQ_OPEN_DUPLEX, SND_SEQ_NONBLOCK ) < 0 )
+    return 0;
+  snd_seq_set_client_name( seq, clientName.c_str() );
+
+  AlsaSharedClient *shared = new AlsaSharedClient;
+  shared->seq = seq;
+  shared->queue_id = -1;
+  shared->queueOffset = 0;
+  shared->running = false;
+  shared->users = 1;
+  shared->epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+  shared->wake_fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+  if ( shared->epoll_fd < 0 || shared->wake_fd < 0 ) {
+    alsaCloseShared( shared );
+    return 0;
   }
 
-  if ( buffer ) free( buffer );
-  snd_midi_event_free( apiData->coder );
-  apiData->coder = 0;
-  apiData->thread = apiData->dummy_thread_id;
-  return 0;
+  // The dispatcher waits for the sequencer and the wakeup eventfd.
+  int count = snd_seq_poll_descriptors_count( seq, POLLIN );
+  std::vector<struct pollfd> fds( count );
+  count = snd_seq_poll_descriptors( seq, fds.data(), count, POLLIN );
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.fd = shared->wake_fd;
+  bool ok = epoll_ctl( shared->epoll_fd, EPOLL_CTL_ADD, shared->wake_fd, &event ) == 0;
+  for ( int i = 0; ok && i < count; i++ ) {
+    event.data.fd = fds[i].fd;
+    ok = epoll_ctl( shared->epoll_fd, EPOLL_CTL_ADD, fds[i].fd, &event ) == 0;
+  }
+  if ( !ok ) {
+    alsaCloseShared( shared );
+    return 0;
+  }
+
+  // Nothing is delivered until an instance routes a port.
+  alsaFilterShared( shared );
+
+  // One queue, running as long as the client exists, stamps the
+  // events of every port.
+#ifndef AVOID_TIMESTAMPING
+  shared->queue_id = snd_seq_alloc_named_queue( seq, "RtMidi Queue" );
+  snd_seq_queue_tempo_t *qtempo;
+  snd_seq_queue_tempo_alloca( &qtempo );
+  snd_seq_queue_tempo_set_tempo( qtempo, 600000 );
+  snd_seq_queue_tempo_set_ppq( qtempo, 240 );
+  snd_seq_set_queue_tempo( seq, shared->queue_id, qtempo );
+  snd_seq_start_queue( seq, shared->queue_id, NULL );
+  snd_seq_drain_output( seq );
+  shared->queueOffset = alsaQueueOffset( seq, shared->queue_id );
+#endif
+
+  pthread_attr_t attr;
+  pthread_attr_init( &attr );
+  pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_JOINABLE );
+  pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
+  shared->running = true;
+  int err = pthread_create( &shared->thread, &attr, alsaSharedHandler, shared );
+  pthread_attr_destroy( &attr );
+  if ( err ) {
+    alsaCloseShared( shared );
+    return 0;
+  }
+
+  alsaShared = shared;
+  return shared;
+}
+
+// Release a user of the shared client, stopping its dispatcher thread
+// and closing it after the last one.
+static void alsaReleaseShared( AlsaSharedClient *shared )
+{
+  std::lock_guard<std::mutex> lock( alsaSharedMutex );
+  if ( --shared->users > 0 ) return;
+
+  alsaShared = 0;
+  shared->running = false;
+  uint64_t value = 1;
+  ssize_t res = write( shared->wake_fd, &value, sizeof( value ) );
+  (void) res;
+  pthread_join( shared->thread, NULL );
+  alsaCloseShared( shared );
+}
+
+// Route the events for a port of the shared client to an instance, or
+// stop routing them if "data" is 0.  Once this returns, the dispatcher
+// no longer delivers to an instance that was removed.
+static void alsaRouteShared( AlsaSharedClient *shared, int port, MidiInApi::RtMidiInData *data )
+{
+  std::lock_guard<std::mutex> lock( shared->mutex );
+  std::map<int, MidiInApi::RtMidiInData *>::iterator it = shared->ports.find( port );
+  if ( it != shared->ports.end() ) {
+    it->second->batching = false;
+    shared->ports.erase( it );
+  }
+  if ( data ) {
+    AlsaMidiData *apiData = static_cast<AlsaMidiData *> (data->apiData);
+    apiData->continueSysex = false;
+    data->batching = true;
+    shared->ports[port] = data;
+  }
+  alsaFilterShared( shared );
 }
 
 MidiInAlsa :: MidiInAlsa( const std::string &clientName, unsigned int queueSizeLimit )
@@ -2001,8 +3766,18 @@ MidiInAlsa :: ~MidiInAlsa()
   // Close a connection if it exists.
   MidiInAlsa::closePort();
 
-  // Shutdown the input thread.
+  // Leave the shared client, which closes once its last user is gone.
   AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( data->portCallback ) alsaWatchPorts( this, true, 0, 0 );
+  alsaReleasePorts();
+  if ( data->shared ) {
+    if ( data->vport >= 0 ) snd_seq_delete_port( data->seq, data->vport );
+    alsaReleaseShared( data->shared );
+    delete data;
+    return;
+  }
+
+  // Shutdown the input thread.
   if ( inputData_.doInput ) {
     inputData_.doInput = false;
     int res = write( data->trigger_fds[1], &inputData_.doInput, sizeof( inputData_.doInput ) );
@@ -2024,17 +3799,29 @@ MidiInAlsa :: ~MidiInAlsa()
 
 void MidiInAlsa :: initialize( const std::string& clientName )
 {
-  // Set up the ALSA sequencer client.
+  // Set up the ALSA sequencer client, or join the shared one.
   snd_seq_t *seq;
-  int result = snd_seq_open( &seq, "default", SND_SEQ_OPEN_DUPLEX, SND_SEQ_NONBLOCK );
-  if ( result < 0 ) {
-    errorString_ = "MidiInAlsa::initialize: error creating ALSA sequencer client object.";
-    error( RtMidiError::DRIVER_ERROR, errorString_ );
-    return;
+  AlsaSharedClient *shared = 0;
+  if ( RtMidi::isSharedClient() ) {
+    shared = alsaAcquireShared( clientName );
+    if ( !shared ) {
+      errorString_ = "MidiInAlsa::initialize: error creating the shared ALSA sequencer client.";
+      error( RtMidiError::DRIVER_ERROR, errorString_ );
+      return;
+    }
+    seq = shared->seq;
   }
+  else {
+    int result = snd_seq_open( &seq, "default", SND_SEQ_OPEN_DUPLEX, SND_SEQ_NONBLOCK );
+    if ( result < 0 ) {
+      errorString_ = "MidiInAlsa::initialize: error creating ALSA sequencer client object.";
+      error( RtMidiError::DRIVER_ERROR, errorString_ );
+      return;
+    }
 
-  // Set client name.
-  snd_seq_set_client_name( seq, clientName.c_str() );
+    // Set client name.
+    snd_seq_set_client_name( seq, clientName.c_str() );
+  }
 
   // Save our api-specific connection information.
   AlsaMidiData *data = (AlsaMidiData *) new AlsaMidiData;
@@ -2046,10 +3833,28 @@ void MidiInAlsa :: initialize( const std::string& clientName )
   data->thread = data->dummy_thread_id;
   data->trigger_fds[0] = -1;
   data->trigger_fds[1] = -1;
+  data->queueOffset = 0;
+  data->inputBufferRequest = 0;
+  data->overruns = 0;
+  data->continueSysex = false;
+  data->shared = shared;
+  data->portCallback = false;
+  data->threadScheduled = false;
+  data->threadPinned = false;
+  data->threadPolicy = SCHED_OTHER;
+  data->threadPriority = 0;
   data->bufferSize = inputData_.bufferSize;
   apiData_ = (void *) data;
   inputData_.apiData = (void *) data;
 
+  // The shared client's queue and dispatcher thread serve all ports.
+  if ( shared ) {
+    data->queue_id = shared->queue_id;
+    data->queueOffset = shared->queueOffset;
+    alsaAcquirePorts();
+    return;
+  }
+
   if ( pipe(data->trigger_fds) == -1 ) {
     errorString_ = "MidiInAlsa::initialize: error creating pipe objects.";
     error( RtMidiError::DRIVER_ERROR, errorString_ );
@@ -2067,80 +3872,29 @@ void MidiInAlsa :: initialize( const std::string& clientName )
   snd_seq_set_queue_tempo( data->seq, data->queue_id, qtempo );
   snd_seq_drain_output( data->seq );
 #endif
-}
-
-// This function is used to count or get the pinfo structure for a given port number.
-unsigned int portInfo( snd_seq_t *seq, snd_seq_port_info_t *pinfo, unsigned int type, int portNumber )
-{
-  snd_seq_client_info_t *cinfo;
-  int client;
-  int count = 0;
-  snd_seq_client_info_alloca( &cinfo );
-
-  snd_seq_client_info_set_client( cinfo, -1 );
-  while ( snd_seq_query_next_client( seq, cinfo ) >= 0 ) {
-    client = snd_seq_client_info_get_client( cinfo );
-    if ( client == 0 ) continue;
-    // Reset query info
-    snd_seq_port_info_set_client( pinfo, client );
-    snd_seq_port_info_set_port( pinfo, -1 );
-    while ( snd_seq_query_next_port( seq, pinfo ) >= 0 ) {
-      unsigned int atyp = snd_seq_port_info_get_type( pinfo );
-      if ( ( ( atyp & SND_SEQ_PORT_TYPE_MIDI_GENERIC ) == 0 ) &&
-           ( ( atyp & SND_SEQ_PORT_TYPE_SYNTH ) == 0 ) &&
-           ( ( atyp & SND_SEQ_PORT_TYPE_APPLICATION ) == 0 ) ) continue;
-
-      unsigned int caps = snd_seq_port_info_get_capability( pinfo );
-      if ( ( ( caps & type ) != type ) ||
-           ( ( caps & SND_SEQ_PORT_CAP_NO_EXPORT ) != 0 ) ) continue;
-
-      if ( count == portNumber ) return 1;
-      ++count;
-    }
-  }
 
-  // If a negative portNumber was used, return the port count.
-  if ( portNumber < 0 ) return count;
-  return 0;
+  // Keep the types ignored by default out of the client.
+  alsaSetEventFilter( seq, inputData_.ignoredTypes );
+  alsaAcquirePorts();
 }
 
 unsigned int MidiInAlsa :: getPortCount()
 {
-  snd_seq_port_info_t *pinfo;
-  snd_seq_port_info_alloca( &pinfo );
-
   AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
-  return portInfo( data->seq, pinfo, SND_SEQ_PORT_CAP_READ|SND_SEQ_PORT_CAP_SUBS_READ, -1 );
+  return alsaPortInfo( data->seq, SND_SEQ_PORT_CAP_READ|SND_SEQ_PORT_CAP_SUBS_READ, -1 );
 }
 
 std::string MidiInAlsa :: getPortName( unsigned int portNumber )
 {
-  snd_seq_client_info_t *cinfo;
-  snd_seq_port_info_t *pinfo;
-  snd_seq_client_info_alloca( &cinfo );
-  snd_seq_port_info_alloca( &pinfo );
-
-  std::string stringName;
+  AlsaPort port;
   AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
-  if ( portInfo( data->seq, pinfo, SND_SEQ_PORT_CAP_READ|SND_SEQ_PORT_CAP_SUBS_READ, (int) portNumber ) ) {
-    int cnum = snd_seq_port_info_get_client( pinfo );
-    snd_seq_get_any_client_info( data->seq, cnum, cinfo );
-    std::ostringstream os;
-    os << snd_seq_client_info_get_name( cinfo );
-    os << ":";
-    os << snd_seq_port_info_get_name( pinfo );
-    os << " ";                                    // These lines added to make sure devices are listed
-    os << snd_seq_port_info_get_client( pinfo );  // with full portnames added to ensure individual device names
-    os << ":";
-    os << snd_seq_port_info_get_port( pinfo );
-    stringName = os.str();
-    return stringName;
-  }
+  if ( alsaPortInfo( data->seq, SND_SEQ_PORT_CAP_READ|SND_SEQ_PORT_CAP_SUBS_READ, (int) portNumber, &port ) )
+    return port.name;
 
   // If we get here, we didn't find a match.
   errorString_ = "MidiInAlsa::getPortName: error looking for port name!";
   error( RtMidiError::WARNING, errorString_ );
-  return stringName;
+  return std::string();
 }
 
 void MidiInAlsa :: openPort( unsigned int portNumber, const std::string &portName )
@@ -2158,10 +3912,9 @@ void MidiInAlsa :: openPort( unsigned int portNumber, const std::string &portNam
     return;
   }
 
-  snd_seq_port_info_t *src_pinfo;
-  snd_seq_port_info_alloca( &src_pinfo );
+  AlsaPort source;
   AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
-  if ( portInfo( data->seq, src_pinfo, SND_SEQ_PORT_CAP_READ|SND_SEQ_PORT_CAP_SUBS_READ, (int) portNumber ) == 0 ) {
+  if ( alsaPortInfo( data->seq, SND_SEQ_PORT_CAP_READ|SND_SEQ_PORT_CAP_SUBS_READ, (int) portNumber, &source ) == 0 ) {
     std::ostringstream ost;
     ost << "MidiInAlsa::openPort: the 'portNumber' argument (" << portNumber << ") is invalid.";
     errorString_ = ost.str();
@@ -2170,8 +3923,8 @@ void MidiInAlsa :: openPort( unsigned int portNumber, const std::string &portNam
   }
 
   snd_seq_addr_t sender, receiver;
-  sender.client = snd_seq_port_info_get_client( src_pinfo );
-  sender.port = snd_seq_port_info_get_port( src_pinfo );
+  sender.client = source.client;
+  sender.port = source.port;
   receiver.client = snd_seq_client_id( data->seq );
 
   snd_seq_port_info_t *pinfo;
@@ -2222,26 +3975,24 @@ void MidiInAlsa :: openPort( unsigned int portNumber, const std::string &portNam
     }
   }
 
-  if ( inputData_.doInput == false ) {
+  if ( inputData_.doInput == false && data->shared ) {
+    // Have the dispatcher deliver the port's events to this instance.
+    alsaRouteShared( data->shared, data->vport, &inputData_ );
+    inputData_.doInput = true;
+  }
+  else if ( inputData_.doInput == false ) {
     // Start the input queue
 #ifndef AVOID_TIMESTAMPING
     snd_seq_start_queue( data->seq, data->queue_id, NULL );
     snd_seq_drain_output( data->seq );
+    data->queueOffset = alsaQueueOffset( data->seq, data->queue_id );
 #endif
     // Start our MIDI input thread.
-    pthread_attr_t attr;
-    pthread_attr_init( &attr );
-    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_JOINABLE );
-    pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
-
-    inputData_.doInput = true;
-    int err = pthread_create( &data->thread, &attr, alsaMidiHandler, &inputData_ );
-    pthread_attr_destroy( &attr );
-    if ( err ) {
+    startThread();
+    if ( !inputData_.doInput ) {
       snd_seq_unsubscribe_port( data->seq, data->subscription );
       snd_seq_port_subscribe_free( data->subscription );
       data->subscription = 0;
-      inputData_.doInput = false;
       errorString_ = "MidiInAlsa::openPort: error starting MIDI input thread!";
       error( RtMidiError::THREAD_ERROR, errorString_ );
       return;
@@ -2280,7 +4031,12 @@ void MidiInAlsa :: openVirtualPort( const std::string &portName )
     data->vport = snd_seq_port_info_get_port( pinfo );
   }
 
-  if ( inputData_.doInput == false ) {
+  if ( inputData_.doInput == false && data->shared ) {
+    // Have the dispatcher deliver the port's events to this instance.
+    alsaRouteShared( data->shared, data->vport, &inputData_ );
+    inputData_.doInput = true;
+  }
+  else if ( inputData_.doInput == false ) {
     // Wait for old thread to stop, if still running
     if ( !pthread_equal( data->thread, data->dummy_thread_id ) )
       pthread_join( data->thread, NULL );
@@ -2289,23 +4045,16 @@ void MidiInAlsa :: openVirtualPort( const std::string &portName )
 #ifndef AVOID_TIMESTAMPING
     snd_seq_start_queue( data->seq, data->queue_id, NULL );
     snd_seq_drain_output( data->seq );
+    data->queueOffset = alsaQueueOffset( data->seq, data->queue_id );
 #endif
     // Start our MIDI input thread.
-    pthread_attr_t attr;
-    pthread_attr_init( &attr );
-    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_JOINABLE );
-    pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
-
-    inputData_.doInput = true;
-    int err = pthread_create( &data->thread, &attr, alsaMidiHandler, &inputData_ );
-    pthread_attr_destroy( &attr );
-    if ( err ) {
+    startThread();
+    if ( !inputData_.doInput ) {
       if ( data->subscription ) {
         snd_seq_unsubscribe_port( data->seq, data->subscription );
         snd_seq_port_subscribe_free( data->subscription );
         data->subscription = 0;
       }
-      inputData_.doInput = false;
       errorString_ = "MidiInAlsa::openPort: error starting MIDI input thread!";
       error( RtMidiError::THREAD_ERROR, errorString_ );
       return;
@@ -2313,6 +4062,176 @@ void MidiInAlsa :: openVirtualPort( const std::string &portName )
   }
 }
 
+// Start the input thread with the default scheduling and apply the
+// requested options to it.  doInput is false if the thread could not
+// be started.
+void MidiInAlsa :: startThread( void )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  pthread_attr_t attr;
+  pthread_attr_init( &attr );
+  pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_JOINABLE );
+  pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
+
+  inputData_.doInput = true;
+  int err = pthread_create( &data->thread, &attr, alsaMidiHandler, &inputData_ );
+  pthread_attr_destroy( &attr );
+  if ( err ) {
+    inputData_.doInput = false;
+    return;
+  }
+  applyThreadOptions();
+}
+
+// Apply the requested scheduling, affinity and name to a running input
+// thread, which is the dispatcher thread of the shared client in shared
+// client mode.  They are set on the thread after it has been created, rather
+// than through its attributes, so that missing privileges only produce
+// a warning and the thread keeps its default settings.
+void MidiInAlsa :: applyThreadOptions( void )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  pthread_t thread = data->thread;
+  if ( data->shared )
+    thread = data->shared->thread;
+  else if ( !inputData_.doInput || pthread_equal( data->thread, data->dummy_thread_id ) )
+    return;
+
+  if ( data->threadScheduled ) {
+    struct sched_param param;
+    param.sched_priority = 0;
+    if ( data->threadPolicy != SCHED_OTHER ) {
+      param.sched_priority = std::max( data->threadPriority, sched_get_priority_min( data->threadPolicy ) );
+      param.sched_priority = std::min( param.sched_priority, sched_get_priority_max( data->threadPolicy ) );
+    }
+    int err = pthread_setschedparam( thread, data->threadPolicy, &param );
+    if ( err == EPERM ) {
+      errorString_ = "MidiInAlsa::setThreadScheduling: not permitted to use real-time scheduling, keeping the default.";
+      error( RtMidiError::WARNING, errorString_ );
+    }
+    else if ( err ) {
+      errorString_ = "MidiInAlsa::setThreadScheduling: error setting the input thread scheduling.";
+      error( RtMidiError::WARNING, errorString_ );
+    }
+  }
+
+  if ( data->threadPinned ) {
+    cpu_set_t cpus;
+    CPU_ZERO( &cpus );
+    for ( size_t i = 0; i < data->threadCpus.size(); i++ ) {
+      if ( data->threadCpus[i] < CPU_SETSIZE ) CPU_SET( data->threadCpus[i], &cpus );
+    }
+    if ( data->threadCpus.empty() ) {
+      for ( int i = 0; i < CPU_SETSIZE; i++ ) CPU_SET( i, &cpus );
+    }
+    if ( pthread_setaffinity_np( thread, sizeof( cpus ), &cpus ) ) {
+      errorString_ = "MidiInAlsa::setThreadAffinity: error setting the input thread CPU affinity.";
+      error( RtMidiError::WARNING, errorString_ );
+    }
+  }
+
+  if ( !data->threadName.empty() ) {
+    // Linux limits thread names to 15 characters.
+    if ( pthread_setname_np( thread, data->threadName.substr( 0, 15 ).c_str() ) ) {
+      errorString_ = "MidiInAlsa::setThreadName: error setting the input thread name.";
+      error( RtMidiError::WARNING, errorString_ );
+    }
+  }
+}
+
+void MidiInAlsa :: setSystemBufferSize( unsigned int bufferSize, unsigned int poolSize )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  int result;
+  if ( data->shared ) {
+    // The dispatcher only reads events while holding the mutex.
+    std::lock_guard<std::mutex> lock( data->shared->mutex );
+    result = alsaSetBufferSize( data->seq, true, bufferSize, poolSize );
+  }
+  else if ( !pthread_equal( data->thread, data->dummy_thread_id ) ) {
+    // Leave the input buffer to the input thread, which may be reading it.
+    result = alsaSetBufferSize( data->seq, true, 0, poolSize );
+    if ( bufferSize > 0 ) {
+      data->inputBufferRequest = bufferSize;
+      bool dummy = false;
+      int res = write( data->trigger_fds[1], &dummy, sizeof( dummy ) );
+      (void) res;
+    }
+  }
+  else
+    result = alsaSetBufferSize( data->seq, true, bufferSize, poolSize );
+
+  if ( result < 0 ) {
+    errorString_ = "MidiInAlsa::setSystemBufferSize: error resizing the sequencer buffers.";
+    error( RtMidiError::WARNING, errorString_ );
+  }
+}
+
+unsigned long MidiInAlsa :: getOverrunCount( void )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  return data->overruns;
+}
+
+unsigned long MidiInAlsa :: getLostEventCount( void )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  return alsaLostEvents( data->seq );
+}
+
+void MidiInAlsa :: setPortCallback( RtMidi::RtMidiPortCallback callback, void *userData )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  data->portCallback = alsaWatchPorts( this, true, callback, userData ) && callback;
+  if ( callback && !data->portCallback ) {
+    errorString_ = "MidiInAlsa::setPortCallback: ALSA port announcements are not available.";
+    error( RtMidiError::WARNING, errorString_ );
+  }
+}
+
+void MidiInAlsa :: ignoreMessageTypes( unsigned int types )
+{
+  MidiInApi::ignoreMessageTypes( types );
+
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  int result;
+  if ( data->shared ) {
+    std::lock_guard<std::mutex> lock( data->shared->mutex );
+    result = alsaFilterShared( data->shared );
+  }
+  else
+    result = alsaSetEventFilter( data->seq, types );
+  if ( result < 0 ) {
+    errorString_ = "MidiInAlsa::ignoreMessageTypes: error setting the sequencer event filter.";
+    error( RtMidiError::WARNING, errorString_ );
+  }
+}
+
+void MidiInAlsa :: setThreadScheduling( RtMidiIn::ThreadScheduling scheduling, int priority )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  data->threadScheduled = true;
+  data->threadPolicy = scheduling == RtMidiIn::THREAD_FIFO ? SCHED_FIFO :
+                       scheduling == RtMidiIn::THREAD_RR ? SCHED_RR : SCHED_OTHER;
+  data->threadPriority = priority;
+  applyThreadOptions();
+}
+
+void MidiInAlsa :: setThreadAffinity( const std::vector<unsigned int> &cpus )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  data->threadPinned = true;
+  data->threadCpus = cpus;
+  applyThreadOptions();
+}
+
+void MidiInAlsa :: setThreadName( const std::string &name )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  data->threadName = name;
+  applyThreadOptions();
+}
+
 void MidiInAlsa :: closePort( void )
 {
   AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
@@ -2325,12 +4244,20 @@ void MidiInAlsa :: closePort( void )
     }
     // Stop the input queue
 #ifndef AVOID_TIMESTAMPING
-    snd_seq_stop_queue( data->seq, data->queue_id, NULL );
-    snd_seq_drain_output( data->seq );
+    if ( !data->shared ) {
+      snd_seq_stop_queue( data->seq, data->queue_id, NULL );
+      snd_seq_drain_output( data->seq );
+    }
 #endif
     connected_ = false;
   }
 
+  // Stop routing the shared client's events to this instance.
+  if ( inputData_.doInput && data->shared ) {
+    alsaRouteShared( data->shared, data->vport, 0 );
+    inputData_.doInput = false;
+  }
+
   // Stop thread to avoid triggering the callback, while the port is intended to be closed
   if ( inputData_.doInput ) {
     inputData_.doInput = false;
@@ -2364,6 +4291,27 @@ void MidiInAlsa :: setPortName( const std::string &portName )
 //  Class Definitions: MidiOutAlsa
 //*********************************************************************//
 
+// Write out the output held back under FLUSH_DEFERRED once its
+// deadline has passed.
+static void alsaFlushHandler( AlsaMidiData *data )
+{
+  std::unique_lock<std::mutex> lock( data->outputMutex );
+  while ( !data->stopFlush ) {
+    if ( !data->flushPending )
+      data->flushCondition.wait( lock );
+    else if ( data->flushCondition.wait_until( lock, data->flushDeadline ) == std::cv_status::timeout ) {
+      // Try again later if the output pool is full, but not right away
+      // when maxLatency is zero: the pool takes a while to drain.
+      int result = snd_seq_drain_output( data->seq );
+      if ( result > 0 || result == -EAGAIN )
+        data->flushDeadline = std::chrono::steady_clock::now() +
+          std::max( data->maxLatency, std::chrono::steady_clock::duration( std::chrono::milliseconds( 1 ) ) );
+      else
+        data->flushPending = false;
+    }
+  }
+}
+
 MidiOutAlsa :: MidiOutAlsa( const std::string &clientName ) : MidiOutApi()
 {
   MidiOutAlsa::initialize( clientName );
@@ -2371,16 +4319,20 @@ MidiOutAlsa :: MidiOutAlsa( const std::string &clientName ) : MidiOutApi()
 
 MidiOutAlsa :: ~MidiOutAlsa()
 {
-  // Close a connection if it exists.
+  // Write out held back messages and close a connection if it exists.
+  stopFlushThread();
+  MidiOutAlsa::flush();
   MidiOutAlsa::closePort();
 
   // Cleanup.
   AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( data->portCallback ) alsaWatchPorts( this, false, 0, 0 );
   if ( data->vport >= 0 ) snd_seq_delete_port( data->seq, data->vport );
   if ( data->coder ) snd_midi_event_free( data->coder );
-  if ( data->buffer ) free( data->buffer );
+  if ( data->queue_id >= 0 ) snd_seq_free_queue( data->seq, data->queue_id );
   snd_seq_close( data->seq );
   delete data;
+  alsaReleasePorts();
 }
 
 void MidiOutAlsa :: initialize( const std::string& clientName )
@@ -2402,9 +4354,17 @@ void MidiOutAlsa :: initialize( const std::string& clientName )
   data->seq = seq;
   data->portNum = -1;
   data->vport = -1;
+  data->shared = 0;
+  data->portCallback = false;
+  data->queue_id = -1; // allocated by the first sendMessageAt()
+  data->queueOffset = 0;
+  data->overruns = 0;
+  data->flushPolicy = RtMidiOut::FLUSH_BATCH;
+  data->maxLatency = std::chrono::steady_clock::duration::zero();
+  data->flushPending = false;
+  data->stopFlush = true;
   data->bufferSize = 32;
   data->coder = 0;
-  data->buffer = 0;
   int result = snd_midi_event_new( data->bufferSize, &data->coder );
   if ( result < 0 ) {
     delete data;
@@ -2412,54 +4372,28 @@ void MidiOutAlsa :: initialize( const std::string& clientName )
     error( RtMidiError::DRIVER_ERROR, errorString_ );
     return;
   }
-  data->buffer = (unsigned char *) malloc( data->bufferSize );
-  if ( data->buffer == NULL ) {
-    delete data;
-    errorString_ = "MidiOutAlsa::initialize: error allocating buffer memory!\n\n";
-    error( RtMidiError::MEMORY_ERROR, errorString_ );
-    return;
-  }
   snd_midi_event_init( data->coder );
   apiData_ = (void *) data;
+  alsaAcquirePorts();
 }
 
 unsigned int MidiOutAlsa :: getPortCount()
 {
-  snd_seq_port_info_t *pinfo;
-  snd_seq_port_info_alloca( &pinfo );
-
   AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
-  return portInfo( data->seq, pinfo, SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_SUBS_WRITE, -1 );
+  return alsaPortInfo( data->seq, SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_SUBS_WRITE, -1 );
 }
 
 std::string MidiOutAlsa :: getPortName( unsigned int portNumber )
 {
-  snd_seq_client_info_t *cinfo;
-  snd_seq_port_info_t *pinfo;
-  snd_seq_client_info_alloca( &cinfo );
-  snd_seq_port_info_alloca( &pinfo );
-
-  std::string stringName;
+  AlsaPort port;
   AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
-  if ( portInfo( data->seq, pinfo, SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_SUBS_WRITE, (int) portNumber ) ) {
-    int cnum = snd_seq_port_info_get_client( pinfo );
-    snd_seq_get_any_client_info( data->seq, cnum, cinfo );
-    std::ostringstream os;
-    os << snd_seq_client_info_get_name( cinfo );
-    os << ":";
-    os << snd_seq_port_info_get_name( pinfo );
-    os << " ";                                    // These lines added to make sure devices are listed
-    os << snd_seq_port_info_get_client( pinfo );  // with full portnames added to ensure individual device names
-    os << ":";
-    os << snd_seq_port_info_get_port( pinfo );
-    stringName = os.str();
-    return stringName;
-  }
+  if ( alsaPortInfo( data->seq, SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_SUBS_WRITE, (int) portNumber, &port ) )
+    return port.name;
 
   // If we get here, we didn't find a match.
   errorString_ = "MidiOutAlsa::getPortName: error looking for port name!";
   error( RtMidiError::WARNING, errorString_ );
-  return stringName;
+  return std::string();
 }
 
 void MidiOutAlsa :: openPort( unsigned int portNumber, const std::string &portName )
@@ -2477,10 +4411,9 @@ void MidiOutAlsa :: openPort( unsigned int portNumber, const std::string &portNa
     return;
   }
 
-  snd_seq_port_info_t *pinfo;
-  snd_seq_port_info_alloca( &pinfo );
+  AlsaPort destination;
   AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
-  if ( portInfo( data->seq, pinfo, SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_SUBS_WRITE, (int) portNumber ) == 0 ) {
+  if ( alsaPortInfo( data->seq, SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_SUBS_WRITE, (int) portNumber, &destination ) == 0 ) {
     std::ostringstream ost;
     ost << "MidiOutAlsa::openPort: the 'portNumber' argument (" << portNumber << ") is invalid.";
     errorString_ = ost.str();
@@ -2489,8 +4422,8 @@ void MidiOutAlsa :: openPort( unsigned int portNumber, const std::string &portNa
   }
 
   snd_seq_addr_t sender, receiver;
-  receiver.client = snd_seq_port_info_get_client( pinfo );
-  receiver.port = snd_seq_port_info_get_port( pinfo );
+  receiver.client = destination.client;
+  receiver.port = destination.port;
   sender.client = snd_seq_client_id( data->seq );
 
   if ( data->vport < 0 ) {
@@ -2530,6 +4463,7 @@ void MidiOutAlsa :: openPort( unsigned int portNumber, const std::string &portNa
 void MidiOutAlsa :: closePort( void )
 {
   if ( connected_ ) {
+    MidiOutAlsa::flush();
     AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
     snd_seq_unsubscribe_port( data->seq, data->subscription );
     snd_seq_port_subscribe_free( data->subscription );
@@ -2571,7 +4505,150 @@ void MidiOutAlsa :: openVirtualPort( const std::string &portName )
   }
 }
 
+void MidiOutAlsa :: setSystemBufferSize( unsigned int bufferSize, unsigned int poolSize )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( alsaSetBufferSize( data->seq, false, bufferSize, poolSize ) < 0 ) {
+    errorString_ = "MidiOutAlsa::setSystemBufferSize: error resizing the sequencer buffers.";
+    error( RtMidiError::WARNING, errorString_ );
+  }
+}
+
+unsigned long MidiOutAlsa :: getOverrunCount( void )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  return data->overruns;
+}
+
+unsigned long MidiOutAlsa :: getLostEventCount( void )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  return alsaLostEvents( data->seq );
+}
+
+void MidiOutAlsa :: setPortCallback( RtMidi::RtMidiPortCallback callback, void *userData )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  data->portCallback = alsaWatchPorts( this, false, callback, userData ) && callback;
+  if ( callback && !data->portCallback ) {
+    errorString_ = "MidiOutAlsa::setPortCallback: ALSA port announcements are not available.";
+    error( RtMidiError::WARNING, errorString_ );
+  }
+}
+
 void MidiOutAlsa :: sendMessage( const unsigned char *message, size_t size )
+{
+  const size_t offsets[2] = { 0, size };
+  sendMessages( message, offsets, 1 );
+}
+
+void MidiOutAlsa :: sendMessages( const unsigned char *bytes, const size_t *offsets, size_t count )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  std::lock_guard<std::mutex> lock( data->outputMutex );
+  writeMessages( bytes, offsets, count, -1 );
+}
+
+void MidiOutAlsa :: sendMessageAt( int64_t monotonicTime, const unsigned char *message, size_t size )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  std::lock_guard<std::mutex> lock( data->outputMutex );
+
+  // The sequencer holds scheduled events on a queue of our own.
+  if ( data->queue_id < 0 ) {
+    int queue = snd_seq_alloc_named_queue( data->seq, "RtMidi Output Queue" );
+    if ( queue < 0 ) {
+      errorString_ = "MidiOutAlsa::sendMessageAt: error allocating the output queue.";
+      error( RtMidiError::DRIVER_ERROR, errorString_ );
+      return;
+    }
+    snd_seq_start_queue( data->seq, queue, NULL );
+    snd_seq_drain_output( data->seq );
+    data->queue_id = queue;
+    data->queueOffset = alsaQueueOffset( data->seq, queue );
+  }
+
+  const size_t offsets[2] = { 0, size };
+  writeMessages( message, offsets, 1, std::max( monotonicTime - data->queueOffset, (int64_t) 0 ) );
+}
+
+// Write messages to the output buffer, scheduled at queueTime on the
+// output queue or direct if queueTime is negative, and drain it as the
+// flush policy requires.  The caller holds the output mutex.
+void MidiOutAlsa :: writeMessages( const unsigned char *bytes, const size_t *offsets, size_t count,
+                                   int64_t queueTime )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+
+  // Events collect in the output buffer, which is written to the
+  // sequencer in one system call when drained, or when it fills up.
+  bool written = false;
+  for ( size_t i = 0; i < count; i++ ) {
+    if ( !outputMessage( bytes + offsets[i], offsets[i + 1] - offsets[i], queueTime ) ) break;
+    if ( data->flushPolicy == RtMidiOut::FLUSH_IMMEDIATE )
+      snd_seq_drain_output( data->seq );
+    written = true;
+  }
+
+  if ( data->flushPolicy != RtMidiOut::FLUSH_DEFERRED ) {
+    snd_seq_drain_output( data->seq );
+    data->flushPending = false;
+  }
+  else if ( written && !data->flushPending ) {
+    data->flushPending = true;
+    data->flushDeadline = std::chrono::steady_clock::now() + data->maxLatency;
+    data->flushCondition.notify_one();
+  }
+}
+
+void MidiOutAlsa :: setFlushPolicy( RtMidiOut::FlushPolicy policy, double maxLatency )
+{
+  if ( maxLatency < 0.0 ) {
+    errorString_ = "MidiOutAlsa::setFlushPolicy: the maximum latency cannot be negative.";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( policy != RtMidiOut::FLUSH_DEFERRED ) stopFlushThread();
+
+  std::lock_guard<std::mutex> lock( data->outputMutex );
+  data->flushPolicy = policy;
+  data->maxLatency = std::chrono::duration_cast<std::chrono::steady_clock::duration>
+    ( std::chrono::duration<double>( maxLatency ) );
+  if ( policy != RtMidiOut::FLUSH_DEFERRED ) {
+    snd_seq_drain_output( data->seq );
+    data->flushPending = false;
+  }
+  else if ( !data->flushThread.joinable() ) {
+    data->stopFlush = false;
+    data->flushThread = std::thread( alsaFlushHandler, data );
+  }
+}
+
+void MidiOutAlsa :: flush( void )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  std::lock_guard<std::mutex> lock( data->outputMutex );
+  snd_seq_drain_output( data->seq );
+  data->flushPending = false;
+}
+
+void MidiOutAlsa :: stopFlushThread( void )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( !data->flushThread.joinable() ) return;
+  {
+    std::lock_guard<std::mutex> lock( data->outputMutex );
+    data->stopFlush = true;
+  }
+  data->flushCondition.notify_one();
+  data->flushThread.join();
+}
+
+// Encode a message into the output buffer.  The caller holds the
+// output mutex.
+bool MidiOutAlsa :: outputMessage( const unsigned char *message, size_t size, int64_t queueTime )
 {
   long result;
   AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
@@ -2582,38 +4659,37 @@ void MidiOutAlsa :: sendMessage( const unsigned char *message, size_t size )
     if ( result != 0 ) {
       errorString_ = "MidiOutAlsa::sendMessage: ALSA error resizing MIDI event buffer.";
       error( RtMidiError::DRIVER_ERROR, errorString_ );
-      return;
-    }
-    free (data->buffer);
-    data->buffer = (unsigned char *) malloc( data->bufferSize );
-    if ( data->buffer == NULL ) {
-      errorString_ = "MidiOutAlsa::initialize: error allocating buffer memory!\n\n";
-      error( RtMidiError::MEMORY_ERROR, errorString_ );
-      return;
+      return false;
     }
   }
 
-  for ( unsigned int i=0; i<nBytes; ++i ) data->buffer[i] = message[i];
-
+  // The encoder reads the caller's bytes directly.
   unsigned int offset = 0;
   while (offset < nBytes) {
     snd_seq_event_t ev;
     snd_seq_ev_clear( &ev );
     snd_seq_ev_set_source( &ev, data->vport );
     snd_seq_ev_set_subs( &ev );
-    snd_seq_ev_set_direct( &ev );
-    result = snd_midi_event_encode( data->coder, data->buffer + offset,
+    if ( queueTime >= 0 ) {
+      snd_seq_real_time_t time;
+      time.tv_sec = (unsigned int) ( queueTime / 1000000000 );
+      time.tv_nsec = (unsigned int) ( queueTime % 1000000000 );
+      snd_seq_ev_schedule_real( &ev, data->queue_id, 0, &time );
+    }
+    else
+      snd_seq_ev_set_direct( &ev );
+    result = snd_midi_event_encode( data->coder, message + offset,
                                     (long)(nBytes - offset), &ev );
     if ( result < 0 ) {
       errorString_ = "MidiOutAlsa::sendMessage: event parsing error!";
       error( RtMidiError::WARNING, errorString_ );
-      return;
+      return false;
     }
 
     if ( ev.type == SND_SEQ_EVENT_NONE ) {
       errorString_ = "MidiOutAlsa::sendMessage: incomplete message!";
       error( RtMidiError::WARNING, errorString_ );
-      return;
+      return false;
     }
 
     offset += result;
@@ -2621,12 +4697,13 @@ void MidiOutAlsa :: sendMessage( const unsigned char *message, size_t size )
     // Send the event.
     result = snd_seq_event_output( data->seq, &ev );
     if ( result < 0 ) {
+      if ( result == -EAGAIN ) data->overruns++; // the output pool is full
       errorString_ = "MidiOutAlsa::sendMessage: error sending MIDI message to port.";
       error( RtMidiError::WARNING, errorString_ );
-      return;
+      return false;
     }
   }
-  snd_seq_drain_output( data->seq );
+  return true;
 }
 
 #endif // __LINUX_ALSA__
@@ -2709,10 +4786,10 @@ static void CALLBACK midiInputCallback( HMIDIIN /*hmin*/,
 
   // Calculate time stamp.
   if ( data->firstMessage == true ) {
-    apiData->message.timeStamp = 0.0;
+    apiData->message.delta = RtMidiIn::Duration( 0 );
     data->firstMessage = false;
   }
-  else apiData->message.timeStamp = (double) ( timestamp - apiData->lastTime ) * 0.001;
+  else apiData->message.delta = std::chrono::milliseconds( (int64_t) ( timestamp - apiData->lastTime ) );
 
   if ( inputStatus == MIM_DATA ) { // Channel or system message
 
@@ -2776,15 +4853,8 @@ static void CALLBACK midiInputCallback( HMIDIIN /*hmin*/,
   // Save the time of the last non-filtered message
   apiData->lastTime = timestamp;
 
-  if ( data->usingCallback ) {
-    RtMidiIn::RtMidiCallback callback = (RtMidiIn::RtMidiCallback) data->userCallback;
-    callback( apiData->message.timeStamp, &apiData->message.bytes, data->userData );
-  }
-  else {
-    // As long as we haven't reached our queue size limit, push the message.
-    if ( !data->queue.push( apiData->message ) )
-      std::cerr << "\nMidiInWinMM: message queue limit reached!!\n\n";
-  }
+  // Invoke the user callback function or queue the message.
+  data->deliver( apiData->message );
 
   // Clear the vector for the next input message.
   apiData->message.bytes.clear();
@@ -3584,7 +5654,7 @@ void UWPMidiClass::midi_in_callback(const MidiInPort&, const MidiMessageReceived
     // Calculate time stamp.
     if (input_data_->firstMessage == true)
     {
-        message.timeStamp = 0.0;
+        message.delta = RtMidiIn::Duration( 0 );
         input_data_->firstMessage = false;
         last_time_ = duration;
 
@@ -3626,8 +5696,7 @@ void UWPMidiClass::midi_in_callback(const MidiInPort&, const MidiMessageReceived
         }
 #endif
 
-        const std::chrono::duration<double> sec{ delta };
-        message.timeStamp = sec.count();
+        message.delta = std::chrono::duration_cast<RtMidiIn::Duration>( delta );
     }
 
     if (((input_data_->ignoreFlags & 0x01) &&
@@ -3650,16 +5719,13 @@ void UWPMidiClass::midi_in_callback(const MidiInPort&, const MidiMessageReceived
 
     if (input_data_->usingCallback)
     {
-        (input_data_->userCallback)(message.timeStamp, &message.bytes, input_data_->userData);
+        input_data_->deliver(message);
     }
     else
     {
         std::lock_guard<std::mutex> lock(mtx_queue_);
 
-        if (!input_data_->queue.push(message))
-        {
-            std::cerr << "\nMidiInWinUWP: message queue limit reached!!\n\n";
-        }
+        input_data_->deliver(message);
     }
 }
 
@@ -3985,112 +6051,635 @@ void MidiOutWinUWP::sendMessage(const unsigned char* message, size_t size)
 #include <jack/jack.h>
 #include <jack/midiport.h>
 #include <jack/ringbuffer.h>
+#include <condition_variable>
+#include <errno.h>
+#include <fcntl.h>
+#include <mutex>
 #include <pthread.h>
 #include <sched.h>
+#include <unistd.h>
 #ifdef HAVE_SEMAPHORE
   #include <semaphore.h>
 #endif
 
-#define JACK_RINGBUFFER_SIZE 16384 // Default size for ringbuffer
+#define JACK_RINGBUFFER_SIZE 16384 // Default size for ringbuffer
+#define JACK_CHUNK_SIZE 256 // Size of the chunks of messages too large for one event
+
+struct JackSharedClient;
+
+struct JackMidiData {
+  jack_client_t *client;
+  JackSharedClient *shared; // the client in shared client mode, or 0
+  int (*process)( jack_nframes_t nframes, void *arg ); // jackProcessIn() or jackProcessOut()
+  jack_port_t *port;
+  jack_ringbuffer_t *buff;
+  size_t buffSize; // size of the input ringbuffer, created when a port is opened
+  int buffMaxWrite; // actual writable size, usually 1 less than ringbuffer
+  std::atomic<size_t> maxEventSize; // largest event an empty output port buffer takes, 0 before the first cycle
+  std::atomic<unsigned int> buffPeak; // largest fill level seen by the writer, see jackTrackFill()
+  jack_time_t lastTime;
+  int64_t monotonicOffset; // monotonic time minus JACK time, in ns
+#ifdef HAVE_SEMAPHORE
+  sem_t sem_cleanup;
+  sem_t sem_needpost;
+  sem_t sem_space; // posted by jackProcessOut() while spaceWaiting is set
+  std::atomic<bool> spaceWaiting;
+#endif
+  MidiInApi :: RtMidiInData *rtMidiIn;
+  std::atomic<bool> realtimeDelivery; // deliver input from the process callback, see jackProcessIn()
+  bool eventsLost; // input events dropped since the last one written, process callback only
+  std::atomic<unsigned long> overruns;
+  std::thread dispatchThread; // see jackDispatchIn()
+  std::atomic<bool> dispatching;
+  std::atomic<bool> dispatchIdle; // set while the dispatch thread waits for input
+  int wakeFds[2]; // pipe through which the process callback wakes the dispatch thread
+  std::vector<unsigned char> event; // dispatch thread only
+  std::mutex portNamesMutex; // guards the cached port list, see jackListPorts()
+  std::vector<std::string> portNames;
+  bool portNamesValid;
+  unsigned long portGeneration;
+  std::mutex portMutex; // guards the port callback, see jackPortRegistration()
+  RtMidi::RtMidiPortCallback portCallback;
+  void *portCallbackUserData;
+  std::vector<std::string> reportedPorts; // the ports known to the port callback, guarded by portMutex
+  unsigned long portFlags; // the flags of the ports the instance lists
+  };
+
+// Counts the ports registered, unregistered or renamed by the
+// instances of the process, whose notifications may arrive after the
+// instance that made the change already lists ports again.
+static std::atomic<unsigned long> jackPortGeneration( 0 );
+
+// Fill the cached list of the ports the instance lists, unless it is
+// still valid: no port came, went or was renamed since it was read.
+// The caller holds portNamesMutex.
+static void jackListPorts( JackMidiData *data )
+{
+  unsigned long generation = jackPortGeneration.load();
+  if ( data->portNamesValid && data->portGeneration == generation ) return;
+
+  data->portNames.clear();
+  const char **ports = jack_get_ports( data->client, NULL, JACK_DEFAULT_MIDI_TYPE, data->portFlags );
+  if ( ports ) {
+    for ( unsigned int i = 0; ports[i]; i++ )
+      data->portNames.push_back( ports[i] );
+    jack_free( ports );
+  }
+  data->portNamesValid = true;
+  data->portGeneration = generation;
+}
+
+// Drop the cached port list of the instance.
+static void jackInvalidatePorts( JackMidiData *data )
+{
+  std::lock_guard<std::mutex> lock( data->portNamesMutex );
+  data->portNamesValid = false;
+}
+
+// Compare the ports the instance lists with those last reported to the
+// port callback, and report the ports that came and went.  A departed
+// port cannot be queried reliably (JACK2 releases it before notifying),
+// so removals are reported from the record.  "departed" names a port
+// being unregistered that may still be listed.  The caller holds
+// portMutex.
+static void jackReportPorts( JackMidiData *data, const char *departed )
+{
+  std::vector<std::string> names;
+  {
+    std::lock_guard<std::mutex> lock( data->portNamesMutex );
+    data->portNamesValid = false;
+    jackListPorts( data );
+    names = data->portNames;
+  }
+  if ( departed )
+    names.erase( std::remove( names.begin(), names.end(), std::string( departed ) ), names.end() );
+
+  std::vector<std::string> removed, added;
+  for ( size_t i = 0; i < data->reportedPorts.size(); i++ ) {
+    if ( std::find( names.begin(), names.end(), data->reportedPorts[i] ) == names.end() )
+      removed.push_back( data->reportedPorts[i] );
+  }
+  for ( size_t i = 0; i < names.size(); i++ ) {
+    if ( std::find( data->reportedPorts.begin(), data->reportedPorts.end(), names[i] ) == data->reportedPorts.end() )
+      added.push_back( names[i] );
+  }
+  data->reportedPorts.swap( names );
+
+  for ( size_t i = 0; i < removed.size(); i++ )
+    data->portCallback( RtMidi::PORT_REMOVED, removed[i], data->portCallbackUserData );
+  for ( size_t i = 0; i < added.size(); i++ )
+    data->portCallback( RtMidi::PORT_ADDED, added[i], data->portCallbackUserData );
+}
+
+// Report the registration and unregistration of the MIDI ports that
+// the instance lists.  Called from JACK's notification thread.
+static void jackPortRegistration( jack_port_id_t id, int registered, void *arg )
+{
+  JackMidiData *data = (JackMidiData *) arg;
+  jackInvalidatePorts( data );
+  std::lock_guard<std::mutex> lock( data->portMutex );
+  if ( !data->portCallback ) return;
+
+  const char *departed = NULL;
+  if ( !registered ) {
+    jack_port_t *port = jack_port_by_id( data->client, id );
+    if ( port ) departed = jack_port_name( port );
+  }
+  jackReportPorts( data, departed );
+}
+
+#ifdef JACK_HAS_PORT_RENAME
+// A renamed port is reported as removed and added again.
+static void jackPortRename( jack_port_id_t, const char *, const char *, void *arg )
+{
+  JackMidiData *data = (JackMidiData *) arg;
+  jackInvalidatePorts( data );
+  std::lock_guard<std::mutex> lock( data->portMutex );
+  if ( !data->portCallback ) return;
+  jackReportPorts( data, NULL );
+}
+#endif
+
+// Set the port callback of an instance, starting from the ports it
+// lists now.
+static void jackWatchPorts( JackMidiData *data, RtMidi::RtMidiPortCallback callback, void *userData )
+{
+  std::lock_guard<std::mutex> lock( data->portMutex );
+  data->portCallback = callback;
+  data->portCallbackUserData = userData;
+  data->reportedPorts.clear();
+  if ( callback && data->client ) {
+    std::lock_guard<std::mutex> namesLock( data->portNamesMutex );
+    jackListPorts( data );
+    data->reportedPorts = data->portNames;
+  }
+}
+
+// Return the offset of the monotonic time from JACK time, in ns.  JACK
+// time usually is the monotonic clock already, but don't rely on it.
+static int64_t jackMonotonicOffset()
+{
+  int64_t before = RtMidiIn::getMonotonicTime();
+  jack_time_t now = jack_get_time();
+  int64_t after = RtMidiIn::getMonotonicTime();
+  return before + ( after - before ) / 2 - (int64_t) now * 1000;
+}
+
+// Record the fill level of the ringbuffer after writing to it.  Only
+// the writing side calls this, so the peak needs no compare-exchange.
+static void jackTrackFill( JackMidiData *data )
+{
+  unsigned int fill = (unsigned int) jack_ringbuffer_read_space( data->buff );
+  if ( fill > data->buffPeak.load( std::memory_order_relaxed ) )
+    data->buffPeak.store( fill, std::memory_order_relaxed );
+}
+
+// Have JACK report port changes to the instance's port callback.
+static void jackSetPortCallbacks( JackMidiData *data )
+{
+  jack_set_port_registration_callback( data->client, jackPortRegistration, data );
+#ifdef JACK_HAS_PORT_RENAME
+  jack_set_port_rename_callback( data->client, jackPortRename, data );
+#endif
+}
+
+// The JACK client shared by the instances created in shared client
+// mode (see RtMidi::setSharedClient()).  Each instance registers its
+// port on it, and a single process callback services them all.  The
+// callback reads the instance list through an atomic pointer without
+// locking: a change installs a new list, and the old one is freed once
+// the callback has completed a cycle, or the server has stopped serving
+// the client.
+struct JackSharedClient {
+  jack_client_t *client;
+  unsigned int users; // guarded by jackSharedMutex
+  std::atomic<std::vector<JackMidiData *> *> instances;
+  std::atomic<unsigned long> cycles; // process cycles completed
+  std::atomic<bool> shutdown; // set by jackSharedShutdown()
+#ifdef HAVE_SEMAPHORE
+  sem_t sem_cycle; // posted at the end of a cycle while cycleWaiting is set
+  std::atomic<bool> cycleWaiting;
+#endif
+  std::vector<std::vector<JackMidiData *> *> retired; // lists a stalled cycle may still use
+  std::mutex callbackMutex; // guards calling and notifier
+  const JackMidiData *calling; // the instance whose port callback runs, or 0
+  std::condition_variable called; // signalled when a port callback returns
+  std::thread::id notifier; // the thread reporting port changes
+};
+
+static std::mutex jackSharedMutex;
+static JackSharedClient *jackShared = 0;
+
+static int jackProcessShared( jack_nframes_t nframes, void *arg )
+{
+  JackSharedClient *shared = (JackSharedClient *) arg;
+  std::vector<JackMidiData *> *instances = shared->instances.load( std::memory_order_acquire );
+  for ( size_t i = 0; i < instances->size(); i++ )
+    (*instances)[i]->process( nframes, (*instances)[i] );
+  shared->cycles.fetch_add( 1, std::memory_order_release );
+#ifdef HAVE_SEMAPHORE
+  if ( shared->cycleWaiting.exchange( false ) )
+    sem_post( &shared->sem_cycle );
+#endif
+  return 0;
+}
+
+// Called once the server stops serving the shared client (it shut down
+// or dropped the client), after which the process callback is not
+// called again.
+static void jackSharedShutdown( void *arg )
+{
+  JackSharedClient *shared = (JackSharedClient *) arg;
+  shared->shutdown = true;
+#ifdef HAVE_SEMAPHORE
+  if ( shared->cycleWaiting.exchange( false ) )
+    sem_post( &shared->sem_cycle );
+#endif
+}
+
+// Report a port change to each instance of the shared client.  The
+// instances are called without callbackMutex, so that their port
+// callbacks can create and delete other instances; jackUpdateShared()
+// waits for a running callback of the instance it removes.
+static void jackSharedReport( JackSharedClient *shared, jack_port_id_t id, int registered, bool renamed )
+{
+  std::unique_lock<std::mutex> lock( shared->callbackMutex );
+  shared->notifier = std::this_thread::get_id();
+  std::vector<JackMidiData *> instances = *shared->instances.load();
+  for ( size_t i = 0; i < instances.size(); i++ ) {
+    // Skip the instances removed by an earlier callback.
+    std::vector<JackMidiData *> *current = shared->instances.load();
+    if ( std::find( current->begin(), current->end(), instances[i] ) == current->end() ) continue;
+    shared->calling = instances[i];
+    lock.unlock();
+#ifdef JACK_HAS_PORT_RENAME
+    if ( renamed )
+      jackPortRename( id, NULL, NULL, instances[i] );
+    else
+#endif
+      jackPortRegistration( id, registered, instances[i] );
+    lock.lock();
+    shared->calling = 0;
+    shared->called.notify_all();
+  }
+}
+
+static void jackSharedPortRegistration( jack_port_id_t id, int registered, void *arg )
+{
+  jackSharedReport( (JackSharedClient *) arg, id, registered, false );
+}
+
+#ifdef JACK_HAS_PORT_RENAME
+static void jackSharedPortRename( jack_port_id_t id, const char *, const char *, void *arg )
+{
+  jackSharedReport( (JackSharedClient *) arg, id, 0, true );
+}
+#endif
+
+// Add an instance to the list of the shared client or remove it, and
+// free the old list once the process callback is done with it.  The
+// caller holds jackSharedMutex.
+static void jackUpdateShared( JackSharedClient *shared, JackMidiData *data, bool add )
+{
+  std::vector<JackMidiData *> *old = shared->instances.load();
+  std::vector<JackMidiData *> *instances = new std::vector<JackMidiData *>( *old );
+  if ( add )
+    instances->push_back( data );
+  else
+    instances->erase( std::remove( instances->begin(), instances->end(), data ), instances->end() );
+  {
+    std::unique_lock<std::mutex> lock( shared->callbackMutex );
+    shared->instances.store( instances, std::memory_order_release );
+    while ( shared->calling == data && shared->notifier != std::this_thread::get_id() )
+      shared->called.wait( lock );
+  }
+
+  // A cycle completed from now on no longer uses the old list or the
+  // removed instance.  Without a server, no cycle runs at all.  If no
+  // cycle completes within a second, the server stalled or runs the
+  // process callback on the calling thread, and the old list is kept
+  // until the client is closed.
+  bool done = shared->shutdown.load();
+#ifdef HAVE_SEMAPHORE
+  struct timespec ts;
+  if ( !done && clock_gettime( CLOCK_REALTIME, &ts ) != -1 ) {
+    ts.tv_sec += 1; // wait max one second
+    shared->cycleWaiting = true;
+    while ( !( done = sem_timedwait( &shared->sem_cycle, &ts ) == 0 ) && errno == EINTR ) {}
+    if ( !done && shared->cycleWaiting.exchange( false ) == false ) {
+      // Posted just after the timeout: take it back for the next wait.
+      while ( sem_wait( &shared->sem_cycle ) < 0 && errno == EINTR ) {}
+      done = true;
+    }
+  }
+#else
+  unsigned long cycles = shared->cycles.load( std::memory_order_acquire );
+  for ( int i = 0; i < 1000 && !done; i++ ) {
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    done = shared->shutdown.load() || shared->cycles.load( std::memory_order_acquire ) != cycles;
+  }
+#endif
+  if ( done || shared->shutdown.load() )
+    delete old;
+  else
+    shared->retired.push_back( old );
+}
+
+// Have an instance serviced by the shared client, opening and
+// activating the client for the first one.  Returns false if the
+// client cannot be opened.
+static bool jackAcquireShared( JackMidiData *data, const std::string &clientName )
+{
+  std::lock_guard<std::mutex> lock( jackSharedMutex );
+  if ( !jackShared ) {
+    jack_client_t *client = jack_client_open( clientName.c_str(), JackNoStartServer, NULL );
+    if ( !client ) return false;
+
+    JackSharedClient *shared = new JackSharedClient;
+    shared->client = client;
+    shared->users = 0;
+    shared->instances = new std::vector<JackMidiData *>;
+    shared->cycles = 0;
+    shared->shutdown = false;
+    shared->calling = 0;
+#ifdef HAVE_SEMAPHORE
+    sem_init( &shared->sem_cycle, 0, 0 );
+    shared->cycleWaiting = false;
+#endif
+    jack_set_process_callback( client, jackProcessShared, shared );
+    jack_on_shutdown( client, jackSharedShutdown, shared );
+    jack_set_port_registration_callback( client, jackSharedPortRegistration, shared );
+#ifdef JACK_HAS_PORT_RENAME
+    jack_set_port_rename_callback( client, jackSharedPortRename, shared );
+#endif
+    if ( jack_activate( client ) != 0 ) {
+      jack_client_close( client );
+      delete shared->instances.load();
+#ifdef HAVE_SEMAPHORE
+      sem_destroy( &shared->sem_cycle );
+#endif
+      delete shared;
+      return false;
+    }
+    jackShared = shared;
+  }
+
+  jackShared->users++;
+  data->shared = jackShared;
+  data->client = jackShared->client;
+  jackUpdateShared( jackShared, data, true );
+  return true;
+}
+
+// Stop servicing an instance, closing the shared client after the last
+// one.  The instance's port is closed already.
+static void jackReleaseShared( JackMidiData *data )
+{
+  std::lock_guard<std::mutex> lock( jackSharedMutex );
+  JackSharedClient *shared = data->shared;
+  jackUpdateShared( shared, data, false );
+  data->shared = 0;
+  data->client = NULL;
+  if ( --shared->users > 0 ) return;
 
-struct JackMidiData {
-  jack_client_t *client;
-  jack_port_t *port;
-  jack_ringbuffer_t *buff;
-  int buffMaxWrite; // actual writable size, usually 1 less than ringbuffer
-  jack_time_t lastTime;
+  jackShared = 0;
+  jack_client_close( shared->client );
+  delete shared->instances.load();
+  for ( size_t i = 0; i < shared->retired.size(); i++ )
+    delete shared->retired[i];
 #ifdef HAVE_SEMAPHORE
-  sem_t sem_cleanup;
-  sem_t sem_needpost;
+  sem_destroy( &shared->sem_cycle );
 #endif
-  MidiInApi :: RtMidiInData *rtMidiIn;
-  };
+  delete shared;
+}
+
+// Release the instance's JACK client, whether its own or the shared one.
+static void jackCloseClient( JackMidiData *data )
+{
+  if ( data->shared )
+    jackReleaseShared( data );
+  else if ( data->client )
+    jack_client_close( data->client );
+  data->client = NULL;
+}
 
 //*********************************************************************//
 //  API: JACK
 //  Class Definitions: MidiInJack
 //*********************************************************************//
 
+// An input event, as written to the ringbuffer by the process
+// callback followed by its bytes.  The size is flagged with
+// JACK_EVENTS_LOST if events before this one had to be dropped.
+struct JackInputEvent {
+  jack_time_t time;
+  jack_nframes_t frame;
+  unsigned int size;
+};
+
+static const unsigned int JACK_EVENTS_LOST = 0x80000000u;
+
+// Assemble an input event into messages and pass them on.  The event
+// is stamped with its frame time and the matching JACK time.
+static void jackParseIn( JackMidiData *jData, jack_nframes_t frame, jack_time_t time,
+                         const unsigned char *bytes, size_t size )
+{
+  MidiInApi :: RtMidiInData *rtData = jData->rtMidiIn;
+  MidiInApi::MidiMessage& message = rtData->message;
+  bool& continueSysex = rtData->continueSysex;
+  unsigned char& ignoreFlags = rtData->ignoreFlags;
+
+  // Compute the delta time.
+  if ( rtData->firstMessage == true ) {
+    message.delta = RtMidiIn::Duration( 0 );
+    rtData->firstMessage = false;
+  } else
+    message.delta = std::chrono::microseconds( (int64_t) ( time - jData->lastTime ) );
+
+  jData->lastTime = time;
+
+  if ( !continueSysex )
+    message.bytes.clear();
+
+  // Only a (possibly continued) SysEx message needs to be collected in
+  // the MIDI message struct, unless we're ignoring SysEx.  Other
+  // messages are delivered straight from the event buffer.
+  bool sysex = continueSysex || bytes[0] == 0xF0;
+  if ( sysex && !( ignoreFlags & 0x01 ) )
+    message.bytes.insert( message.bytes.end(), bytes, bytes + size );
+
+  switch ( bytes[0] ) {
+    case 0xF0:
+      // Start of a SysEx message
+      continueSysex = bytes[size - 1] != 0xF7;
+      if ( ignoreFlags & 0x01 ) return;
+      break;
+    case 0xF1:
+    case 0xF8:
+      // MIDI Time Code or Timing Clock message
+      if ( ignoreFlags & 0x02 ) return;
+      break;
+    case 0xFE:
+      // Active Sensing message
+      if ( ignoreFlags & 0x04 ) return;
+      break;
+    default:
+      if ( continueSysex ) {
+        // Continuation of a SysEx message
+        continueSysex = bytes[size - 1] != 0xF7;
+        if ( ignoreFlags & 0x01 ) return;
+      }
+      // All other MIDI messages
+  }
+
+  if ( !continueSysex ) {
+    // If not a continuation of a SysEx message,
+    // invoke the user callback function or queue the message.
+    RtMidiIn::TimePoint when( RtMidiIn::Duration( jData->monotonicOffset + (int64_t) time * 1000 ) );
+    if ( sysex )
+      rtData->deliver( message.bytes.data(), message.bytes.size(), message.delta, when,
+                       frame, (int64_t) time );
+    else
+      rtData->deliver( bytes, size, message.delta, when, frame, (int64_t) time );
+  }
+}
+
+// Runs in JACK's real-time thread, so unless real-time delivery was
+// requested, the events are only copied into the ringbuffer for
+// jackDispatchIn(): nothing is allocated, locked or printed here.
 static int jackProcessIn( jack_nframes_t nframes, void *arg )
 {
   JackMidiData *jData = (JackMidiData *) arg;
-  MidiInApi :: RtMidiInData *rtData = jData->rtMidiIn;
   jack_midi_event_t event;
-  jack_time_t time;
 
   // Is port created?
   if ( jData->port == NULL ) return 0;
 
   void *buff = jack_port_get_buffer( jData->port, nframes );
-  bool& continueSysex = rtData->continueSysex;
-  unsigned char& ignoreFlags = rtData->ignoreFlags;
+  jack_nframes_t cycleStart = jack_last_frame_time( jData->client );
+  bool realtime = jData->realtimeDelivery.load( std::memory_order_relaxed );
+  bool written = false;
 
   // We have midi events in buffer
   int evCount = jack_midi_get_event_count( buff );
   for (int j = 0; j < evCount; j++) {
-    MidiInApi::MidiMessage& message = rtData->message;
     jack_midi_event_get( &event, buff, j );
+    if ( event.size == 0 ) continue;
 
-    // Compute the delta time.
-    time = jack_get_time();
-    if ( rtData->firstMessage == true ) {
-      message.timeStamp = 0.0;
-      rtData->firstMessage = false;
-    } else
-      message.timeStamp = ( time - jData->lastTime ) * 0.000001;
+    // Stamp the event with its own position in the cycle.
+    jack_nframes_t frame = cycleStart + event.time;
+    jack_time_t time = jack_frames_to_time( jData->client, frame );
 
-    jData->lastTime = time;
-
-    if ( !continueSysex )
-      message.bytes.clear();
-
-    if ( !( ( continueSysex || event.buffer[0] == 0xF0 ) && ( ignoreFlags & 0x01 ) ) ) {
-      // Unless this is a (possibly continued) SysEx message and we're ignoring SysEx,
-      // copy the event buffer into the MIDI message struct.
-      for ( unsigned int i = 0; i < event.size; i++ )
-        message.bytes.push_back( event.buffer[i] );
+    if ( realtime ) {
+      jackParseIn( jData, frame, time, event.buffer, event.size );
+      continue;
     }
 
-    switch ( event.buffer[0] ) {
-      case 0xF0:
-        // Start of a SysEx message
-        continueSysex = event.buffer[event.size - 1] != 0xF7;
-        if ( ignoreFlags & 0x01 ) continue;
-        break;
-      case 0xF1:
-      case 0xF8:
-        // MIDI Time Code or Timing Clock message
-        if ( ignoreFlags & 0x02 ) continue;
-        break;
-      case 0xFE:
-        // Active Sensing message
-        if ( ignoreFlags & 0x04 ) continue;
-        break;
-      default:
-        if ( continueSysex ) {
-          // Continuation of a SysEx message
-          continueSysex = event.buffer[event.size - 1] != 0xF7;
-          if ( ignoreFlags & 0x01 ) continue;
-        }
-        // All other MIDI messages
+    JackInputEvent header;
+    header.time = time;
+    header.frame = frame;
+    header.size = (unsigned int) event.size | ( jData->eventsLost ? JACK_EVENTS_LOST : 0 );
+    if ( jack_ringbuffer_write_space( jData->buff ) < sizeof( header ) + event.size ) {
+      jData->eventsLost = true;
+      jData->overruns.fetch_add( 1, std::memory_order_relaxed );
+      continue;
     }
+    jack_ringbuffer_write( jData->buff, (const char *) &header, sizeof( header ) );
+    jack_ringbuffer_write( jData->buff, (const char *) event.buffer, event.size );
+    jData->eventsLost = false;
+    written = true;
+  }
 
-    if ( !continueSysex ) {
-      // If not a continuation of a SysEx message,
-      // invoke the user callback function or queue the message.
-      if ( rtData->usingCallback ) {
-        RtMidiIn::RtMidiCallback callback = (RtMidiIn::RtMidiCallback) rtData->userCallback;
-        callback( message.timeStamp, &message.bytes, rtData->userData );
-      }
-      else {
-        // As long as we haven't reached our queue size limit, push the message.
-        if ( !rtData->queue.push( message ) )
-          std::cerr << "\nMidiInJack: message queue limit reached!!\n\n";
+  if ( written ) jackTrackFill( jData );
+  if ( realtime )
+    jData->rtMidiIn->flushBatch();
+  else if ( written && jData->dispatchIdle.exchange( false ) ) {
+    // A full pipe already has the dispatch thread woken up.
+    char wake = 0;
+    if ( write( jData->wakeFds[1], &wake, 1 ) < 0 ) {}
+  }
+  return 0;
+}
+
+// Check whether the ringbuffer holds a complete input event, and peek
+// at its header.
+static bool jackPeekIn( JackMidiData *jData, JackInputEvent *header )
+{
+  return jack_ringbuffer_peek( jData->buff, (char *) header, sizeof( *header ) ) == sizeof( *header ) &&
+    jack_ringbuffer_read_space( jData->buff ) >= sizeof( *header ) + ( header->size & ~JACK_EVENTS_LOST );
+}
+
+// The input dispatch thread: reads the events that jackProcessIn()
+// wrote to the ringbuffer, and assembles and delivers the messages.
+static void jackDispatchIn( JackMidiData *jData )
+{
+  JackInputEvent header;
+  while ( jData->dispatching.load() ) {
+    if ( !jackPeekIn( jData, &header ) ) {
+      // Out of events: pass on the batch and wait for the process
+      // callback, checking the ringbuffer again once it can be woken.
+      jData->rtMidiIn->flushBatch();
+      jData->dispatchIdle.store( true );
+      if ( !jackPeekIn( jData, &header ) && jData->dispatching.load() ) {
+        char wake;
+        if ( read( jData->wakeFds[0], &wake, 1 ) < 0 && errno != EINTR ) break;
       }
+      jData->dispatchIdle.store( false );
+      continue;
     }
+
+    jack_ringbuffer_read_advance( jData->buff, sizeof( header ) );
+    unsigned int size = header.size & ~JACK_EVENTS_LOST;
+    if ( jData->event.size() < size ) jData->event.resize( size );
+    jack_ringbuffer_read( jData->buff, (char *) jData->event.data(), size );
+
+    // A SysEx message that lost some of its events is not passed on.
+    if ( header.size & JACK_EVENTS_LOST ) jData->rtMidiIn->continueSysex = false;
+    jackParseIn( jData, header.frame, header.time, jData->event.data(), size );
   }
+}
 
-  return 0;
+static void jackStartDispatch( JackMidiData *jData )
+{
+  jData->dispatching = true;
+  jData->dispatchThread = std::thread( jackDispatchIn, jData );
+}
+
+static void jackStopDispatch( JackMidiData *jData )
+{
+  if ( !jData->dispatchThread.joinable() ) return;
+  jData->dispatching = false;
+  char wake = 0;
+  if ( write( jData->wakeFds[1], &wake, 1 ) < 0 ) {}
+  jData->dispatchThread.join();
+}
+
+// Set up the ringbuffer, the wake-up pipe and the dispatch thread for
+// a port about to be opened, unless input is delivered from the process
+// callback.  Instances that only list ports never need them.  Returns
+// false if they cannot be created.
+static bool jackOpenIn( JackMidiData *jData )
+{
+  if ( jData->realtimeDelivery.load() ) return true;
+
+  if ( !jData->buff ) {
+    jData->buff = jack_ringbuffer_create( jData->buffSize );
+    if ( !jData->buff ) return false;
+    jack_ringbuffer_mlock( jData->buff );
+  }
+  else
+    jack_ringbuffer_reset( jData->buff );
+  jData->eventsLost = false;
+
+  if ( jData->wakeFds[0] < 0 ) {
+    if ( pipe( jData->wakeFds ) < 0 ) {
+      jData->wakeFds[0] = jData->wakeFds[1] = -1;
+      return false;
+    }
+    fcntl( jData->wakeFds[1], F_SETFL, fcntl( jData->wakeFds[1], F_GETFL ) | O_NONBLOCK );
+  }
+  if ( !jData->dispatchThread.joinable() ) jackStartDispatch( jData );
+  return true;
 }
 
 MidiInJack :: MidiInJack( const std::string &clientName, unsigned int queueSizeLimit )
@@ -4107,8 +6696,31 @@ void MidiInJack :: initialize( const std::string& clientName )
   data->rtMidiIn = &inputData_;
   data->port = NULL;
   data->client = NULL;
+  data->buff = NULL;
+  data->buffSize = JACK_RINGBUFFER_SIZE;
+  data->shared = 0;
+  data->process = jackProcessIn;
+  data->portNamesValid = false;
+  data->portGeneration = 0;
+  data->portCallback = 0;
+  data->portCallbackUserData = 0;
+  data->portFlags = JackPortIsOutput;
+  data->realtimeDelivery = false;
+  data->eventsLost = false;
+  data->overruns = 0;
+  data->buffPeak = 0;
+  data->dispatching = false;
+  data->dispatchIdle = false;
+  data->wakeFds[0] = data->wakeFds[1] = -1;
   this->clientName = clientName;
 
+  // A batch callback receives the messages of a process cycle, or
+  // those dispatched at once, together.
+  inputData_.batching = true;
+
+  // Keep assembling SysEx messages from allocating, up to the buffer size.
+  inputData_.message.bytes.reserve( inputData_.bufferSize );
+
   connect();
 }
 
@@ -4118,6 +6730,16 @@ void MidiInJack :: connect()
   if ( data->client )
     return;
 
+  // The instance is processed as soon as it joins a shared client.
+  data->monotonicOffset = jackMonotonicOffset();
+  if ( RtMidi::isSharedClient() ) {
+    if ( !jackAcquireShared( data, clientName ) ) {
+      errorString_ = "MidiInJack::initialize: JACK server not running?";
+      error( RtMidiError::WARNING, errorString_ );
+    }
+    return;
+  }
+
   // Initialize JACK client
   if (( data->client = jack_client_open( clientName.c_str(), JackNoStartServer, NULL )) == 0) {
     errorString_ = "MidiInJack::initialize: JACK server not running?";
@@ -4126,6 +6748,7 @@ void MidiInJack :: connect()
   }
 
   jack_set_process_callback( data->client, jackProcessIn, data );
+  jackSetPortCallbacks( data );
   jack_activate( data->client );
 }
 
@@ -4133,9 +6756,13 @@ MidiInJack :: ~MidiInJack()
 {
   JackMidiData *data = static_cast<JackMidiData *> (apiData_);
   MidiInJack::closePort();
+  jackCloseClient( data );
 
-  if ( data->client )
-    jack_client_close( data->client );
+  // The dispatch thread stopped with the port; free its resources once
+  // the process callback no longer runs.
+  if ( data->wakeFds[0] >= 0 ) close( data->wakeFds[0] );
+  if ( data->wakeFds[1] >= 0 ) close( data->wakeFds[1] );
+  if ( data->buff ) jack_ringbuffer_free( data->buff );
   delete data;
 }
 
@@ -4146,11 +6773,19 @@ void MidiInJack :: openPort( unsigned int portNumber, const std::string &portNam
   connect();
 
   // Creating new port
-  if ( data->port == NULL )
+  if ( data->port == NULL && data->client ) {
+    if ( !jackOpenIn( data ) ) {
+      errorString_ = "MidiInJack::openPort: error creating the input ringbuffer.";
+      error( RtMidiError::MEMORY_ERROR, errorString_ );
+      return;
+    }
     data->port = jack_port_register( data->client, portName.c_str(),
                                      JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0 );
+    jackPortGeneration++;
+  }
 
   if ( data->port == NULL ) {
+    jackStopDispatch( data );
     errorString_ = "MidiInJack::openPort: JACK error creating port";
     if (portName.size() >= (size_t)jack_port_name_size())
         errorString_ += " (port name too long?)";
@@ -4170,11 +6805,19 @@ void MidiInJack :: openVirtualPort( const std::string &portName )
   JackMidiData *data = static_cast<JackMidiData *> (apiData_);
 
   connect();
-  if ( data->port == NULL )
+  if ( data->port == NULL && data->client ) {
+    if ( !jackOpenIn( data ) ) {
+      errorString_ = "MidiInJack::openVirtualPort: error creating the input ringbuffer.";
+      error( RtMidiError::MEMORY_ERROR, errorString_ );
+      return;
+    }
     data->port = jack_port_register( data->client, portName.c_str(),
                                      JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0 );
+    jackPortGeneration++;
+  }
 
   if ( data->port == NULL ) {
+    jackStopDispatch( data );
     errorString_ = "MidiInJack::openVirtualPort: JACK error creating virtual port";
     if (portName.size() >= (size_t)jack_port_name_size())
         errorString_ += " (port name too long?)";
@@ -4184,22 +6827,14 @@ void MidiInJack :: openVirtualPort( const std::string &portName )
 
 unsigned int MidiInJack :: getPortCount()
 {
-  int count = 0;
   JackMidiData *data = static_cast<JackMidiData *> (apiData_);
   connect();
   if ( !data->client )
     return 0;
 
-  // List of available ports
-  const char **ports = jack_get_ports( data->client, NULL, JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput );
-
-  if ( ports == NULL ) return 0;
-  while ( ports[count] != NULL )
-    count++;
-
-  free( ports );
-
-  return count;
+  std::lock_guard<std::mutex> lock( data->portNamesMutex );
+  jackListPorts( data );
+  return (unsigned int) data->portNames.size();
 }
 
 std::string MidiInJack :: getPortName( unsigned int portNumber )
@@ -4208,30 +6843,88 @@ std::string MidiInJack :: getPortName( unsigned int portNumber )
   std::string retStr( "" );
 
   connect();
-
-  // List of available ports
-  const char **ports = jack_get_ports( data->client, NULL,
-                                       JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput );
+  size_t count = 0;
+  if ( data->client ) {
+    std::lock_guard<std::mutex> lock( data->portNamesMutex );
+    jackListPorts( data );
+    count = data->portNames.size();
+    if ( portNumber < count )
+      return data->portNames[portNumber];
+  }
 
   // Check port validity
-  if ( ports == NULL ) {
+  if ( count == 0 ) {
     errorString_ = "MidiInJack::getPortName: no ports available!";
     error( RtMidiError::WARNING, errorString_ );
     return retStr;
   }
 
-  unsigned int i;
-  for ( i=0; i<portNumber && ports[i]; i++ ) {}
-  if ( i < portNumber || !ports[portNumber] ) {
-    std::ostringstream ost;
-    ost << "MidiInJack::getPortName: the 'portNumber' argument (" << portNumber << ") is invalid.";
-    errorString_ = ost.str();
+  std::ostringstream ost;
+  ost << "MidiInJack::getPortName: the 'portNumber' argument (" << portNumber << ") is invalid.";
+  errorString_ = ost.str();
+  error( RtMidiError::WARNING, errorString_ );
+  return retStr;
+}
+
+void MidiInJack :: setPortCallback( RtMidi::RtMidiPortCallback callback, void *userData )
+{
+  JackMidiData *data = static_cast<JackMidiData *> (apiData_);
+  connect();
+  jackWatchPorts( data, callback, userData );
+}
+
+void MidiInJack :: setSystemBufferSize( unsigned int bufferSize, unsigned int )
+{
+  JackMidiData *data = static_cast<JackMidiData *> (apiData_);
+  if ( bufferSize == 0 ) return;
+  // A ringbuffer keeps one byte free, and must hold a 3-byte message.
+  if ( bufferSize < sizeof( JackInputEvent ) + 4 ) {
+    errorString_ = "MidiInJack::setSystemBufferSize: the ringbuffer size is too small for a message.";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+  if ( data->port ) {
+    errorString_ = "MidiInJack::setSystemBufferSize: the ringbuffer cannot be resized while a port is open.";
     error( RtMidiError::WARNING, errorString_ );
+    return;
   }
-  else retStr.assign( ports[portNumber] );
 
-  jack_free( ports );
-  return retStr;
+  // Without a port, the process callback and the dispatch thread leave
+  // the ringbuffer alone.  The next port opened creates a new one.
+  if ( data->buff ) jack_ringbuffer_free( data->buff );
+  data->buff = NULL;
+  data->buffSize = bufferSize;
+  data->buffPeak = 0;
+}
+
+unsigned long MidiInJack :: getOverrunCount( void )
+{
+  JackMidiData *data = static_cast<JackMidiData *> (apiData_);
+  return data->overruns.load();
+}
+
+unsigned int MidiInJack :: getSystemBufferFill( void )
+{
+  JackMidiData *data = static_cast<JackMidiData *> (apiData_);
+  if ( !data->buff ) return 0;
+  return (unsigned int) jack_ringbuffer_read_space( data->buff );
+}
+
+unsigned int MidiInJack :: getSystemBufferPeak( void )
+{
+  JackMidiData *data = static_cast<JackMidiData *> (apiData_);
+  return data->buffPeak.load();
+}
+
+void MidiInJack :: setRealtimeDelivery( bool realtime )
+{
+  JackMidiData *data = static_cast<JackMidiData *> (apiData_);
+  if ( data->port ) {
+    errorString_ = "MidiInJack::setRealtimeDelivery: cannot be changed while a port is open.";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+  data->realtimeDelivery = realtime;
 }
 
 void MidiInJack :: closePort()
@@ -4241,6 +6934,8 @@ void MidiInJack :: closePort()
   if ( data->port == NULL ) return;
   jack_port_unregister( data->client, data->port );
   data->port = NULL;
+  jackPortGeneration++;
+  jackStopDispatch( data );
 
   connected_ = false;
 }
@@ -4261,6 +6956,7 @@ void MidiInJack :: setPortName( const std::string &portName )
 #else
   jack_port_set_name( data->port, portName.c_str() );
 #endif
+  jackPortGeneration++;
 }
 
 //*********************************************************************//
@@ -4268,33 +6964,68 @@ void MidiInJack :: setPortName( const std::string &portName )
 //  Class Definitions: MidiOutJack
 //*********************************************************************//
 
+// An output message, as written to the ringbuffer followed by its
+// bytes.  The time is the JACK time at which it is due, or zero to send
+// it in the next cycle.
+struct JackOutputEvent {
+  jack_time_t time;
+  unsigned int size;
+};
+
 // Jack process callback
 static int jackProcessOut( jack_nframes_t nframes, void *arg )
 {
   JackMidiData *data = (JackMidiData *) arg;
   jack_midi_data_t *midiData;
-  int space;
+  JackOutputEvent header;
 
   // Is port created?
   if ( data->port == NULL ) return 0;
 
   void *buff = jack_port_get_buffer( data->port, nframes );
   jack_midi_clear_buffer( buff );
+  data->maxEventSize.store( jack_midi_max_event_size( buff ), std::memory_order_relaxed );
+  jack_nframes_t cycleStart = jack_last_frame_time( data->client );
+  jack_nframes_t offset = 0;
+  bool drained = false;
+
+  while ( jack_ringbuffer_peek( data->buff, (char *) &header, sizeof( header ) ) == sizeof( header ) &&
+          jack_ringbuffer_read_space( data->buff ) >= sizeof( header ) + header.size ) {
+    // A timed message is placed at its frame, and held for a later
+    // cycle if it is due after this one.  Events must not go before
+    // the previous one, which late and untimed messages follow.
+    jack_nframes_t frame = offset;
+    if ( header.time ) {
+      int32_t due = (int32_t) ( jack_time_to_frames( data->client, header.time ) - cycleStart );
+      if ( due >= (int32_t) nframes ) break;
+      if ( due > (int32_t) offset ) frame = (jack_nframes_t) due;
+    }
 
-  while ( jack_ringbuffer_peek( data->buff, (char *) &space, sizeof( space ) ) == sizeof(space) &&
-          jack_ringbuffer_read_space( data->buff ) >= sizeof(space) + space ) {
-    jack_ringbuffer_read_advance( data->buff, sizeof(space) );
+    // A message that does not fit in the port buffer waits for the
+    // next cycle.  jackWriteOut() splits messages that an empty buffer
+    // cannot take, so one that still does not fit in an empty buffer
+    // is dropped and counted as an overrun.
+    midiData = jack_midi_event_reserve( buff, frame, header.size );
+    if ( !midiData && jack_midi_get_event_count( buff ) > 0 ) break;
 
-    midiData = jack_midi_event_reserve( buff, 0, space );
+    jack_ringbuffer_read_advance( data->buff, sizeof( header ) );
     if ( midiData )
-        jack_ringbuffer_read( data->buff, (char *) midiData, (size_t) space );
-    else
-        jack_ringbuffer_read_advance( data->buff, (size_t) space );
+        jack_ringbuffer_read( data->buff, (char *) midiData, header.size );
+    else {
+        jack_ringbuffer_read_advance( data->buff, header.size );
+        data->overruns.fetch_add( 1, std::memory_order_relaxed );
+    }
+    offset = frame;
+    drained = true;
   }
 
 #ifdef HAVE_SEMAPHORE
+  if ( drained && data->spaceWaiting.exchange( false ) )
+    sem_post( &data->sem_space );
   if ( !sem_trywait( &data->sem_needpost ) )
     sem_post( &data->sem_cleanup );
+#else
+  (void) drained;
 #endif
 
   return 0;
@@ -4312,9 +7043,23 @@ void MidiOutJack :: initialize( const std::string& clientName )
 
   data->port = NULL;
   data->client = NULL;
+  data->shared = 0;
+  data->process = jackProcessOut;
+  data->portNamesValid = false;
+  data->portGeneration = 0;
+  data->portCallback = 0;
+  data->portCallbackUserData = 0;
+  data->portFlags = JackPortIsInput;
+  data->monotonicOffset = 0;
+  data->buff = NULL;
+  data->buffPeak = 0;
+  data->maxEventSize = 0;
+  data->overruns = 0;
 #ifdef HAVE_SEMAPHORE
   sem_init( &data->sem_cleanup, 0, 0 );
   sem_init( &data->sem_needpost, 0, 0 );
+  sem_init( &data->sem_space, 0, 0 );
+  data->spaceWaiting = false;
 #endif
   this->clientName = clientName;
 
@@ -4328,8 +7073,20 @@ void MidiOutJack :: connect()
     return;
 
   // Initialize output ringbuffers
-  data->buff = jack_ringbuffer_create( JACK_RINGBUFFER_SIZE );
-  data->buffMaxWrite = (int) jack_ringbuffer_write_space( data->buff );
+  if ( !data->buff ) {
+    data->buff = jack_ringbuffer_create( JACK_RINGBUFFER_SIZE );
+    data->buffMaxWrite = (int) jack_ringbuffer_write_space( data->buff );
+  }
+
+  // The instance is processed as soon as it joins a shared client.
+  data->monotonicOffset = jackMonotonicOffset();
+  if ( RtMidi::isSharedClient() ) {
+    if ( !jackAcquireShared( data, clientName ) ) {
+      errorString_ = "MidiOutJack::initialize: JACK server not running?";
+      error( RtMidiError::WARNING, errorString_ );
+    }
+    return;
+  }
 
   // Initialize JACK client
   if ( ( data->client = jack_client_open( clientName.c_str(), JackNoStartServer, NULL ) ) == 0 ) {
@@ -4339,6 +7096,7 @@ void MidiOutJack :: connect()
   }
 
   jack_set_process_callback( data->client, jackProcessOut, data );
+  jackSetPortCallbacks( data );
   jack_activate( data->client );
 }
 
@@ -4348,14 +7106,13 @@ MidiOutJack :: ~MidiOutJack()
   MidiOutJack::closePort();
 
   // Cleanup
+  jackCloseClient( data );
   jack_ringbuffer_free( data->buff );
-  if ( data->client ) {
-    jack_client_close( data->client );
-  }
 
 #ifdef HAVE_SEMAPHORE
   sem_destroy( &data->sem_cleanup );
   sem_destroy( &data->sem_needpost );
+  sem_destroy( &data->sem_space );
 #endif
 
   delete data;
@@ -4368,9 +7125,11 @@ void MidiOutJack :: openPort( unsigned int portNumber, const std::string &portNa
   connect();
 
   // Creating new port
-  if ( data->port == NULL )
+  if ( data->port == NULL && data->client ) {
     data->port = jack_port_register( data->client, portName.c_str(),
                                      JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0 );
+    jackPortGeneration++;
+  }
 
   if ( data->port == NULL ) {
     errorString_ = "MidiOutJack::openPort: JACK error creating port";
@@ -4392,9 +7151,11 @@ void MidiOutJack :: openVirtualPort( const std::string &portName )
   JackMidiData *data = static_cast<JackMidiData *> (apiData_);
 
   connect();
-  if ( data->port == NULL )
+  if ( data->port == NULL && data->client ) {
     data->port = jack_port_register( data->client, portName.c_str(),
                                      JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0 );
+    jackPortGeneration++;
+  }
 
   if ( data->port == NULL ) {
     errorString_ = "MidiOutJack::openVirtualPort: JACK error creating virtual port";
@@ -4406,55 +7167,52 @@ void MidiOutJack :: openVirtualPort( const std::string &portName )
 
 unsigned int MidiOutJack :: getPortCount()
 {
-  int count = 0;
   JackMidiData *data = static_cast<JackMidiData *> (apiData_);
   connect();
   if ( !data->client )
     return 0;
 
-  // List of available ports
-  const char **ports = jack_get_ports( data->client, NULL,
-                                       JACK_DEFAULT_MIDI_TYPE, JackPortIsInput );
-
-  if ( ports == NULL ) return 0;
-  while ( ports[count] != NULL )
-    count++;
-
-  free( ports );
-
-  return count;
+  std::lock_guard<std::mutex> lock( data->portNamesMutex );
+  jackListPorts( data );
+  return (unsigned int) data->portNames.size();
 }
 
 std::string MidiOutJack :: getPortName( unsigned int portNumber )
 {
   JackMidiData *data = static_cast<JackMidiData *> (apiData_);
-  std::string retStr("");
+  std::string retStr( "" );
 
   connect();
-
-  // List of available ports
-  const char **ports = jack_get_ports( data->client, NULL,
-                                       JACK_DEFAULT_MIDI_TYPE, JackPortIsInput );
+  size_t count = 0;
+  if ( data->client ) {
+    std::lock_guard<std::mutex> lock( data->portNamesMutex );
+    jackListPorts( data );
+    count = data->portNames.size();
+    if ( portNumber < count )
+      return data->portNames[portNumber];
+  }
 
   // Check port validity
-  if ( ports == NULL ) {
+  if ( count == 0 ) {
     errorString_ = "MidiOutJack::getPortName: no ports available!";
     error( RtMidiError::WARNING, errorString_ );
     return retStr;
   }
 
-  if ( ports[portNumber] == NULL ) {
-    std::ostringstream ost;
-    ost << "MidiOutJack::getPortName: the 'portNumber' argument (" << portNumber << ") is invalid.";
-    errorString_ = ost.str();
-    error( RtMidiError::WARNING, errorString_ );
-  }
-  else retStr.assign( ports[portNumber] );
-
-  free( ports );
+  std::ostringstream ost;
+  ost << "MidiOutJack::getPortName: the 'portNumber' argument (" << portNumber << ") is invalid.";
+  errorString_ = ost.str();
+  error( RtMidiError::WARNING, errorString_ );
   return retStr;
 }
 
+void MidiOutJack :: setPortCallback( RtMidi::RtMidiPortCallback callback, void *userData )
+{
+  JackMidiData *data = static_cast<JackMidiData *> (apiData_);
+  connect();
+  jackWatchPorts( data, callback, userData );
+}
+
 void MidiOutJack :: closePort()
 {
   JackMidiData *data = static_cast<JackMidiData *> (apiData_);
@@ -4472,6 +7230,7 @@ void MidiOutJack :: closePort()
 
   jack_port_unregister( data->client, data->port );
   data->port = NULL;
+  jackPortGeneration++;
 
   connected_ = false;
 }
@@ -4492,22 +7251,161 @@ void MidiOutJack :: setPortName( const std::string &portName )
 #else
   jack_port_set_name( data->port, portName.c_str() );
 #endif
+  jackPortGeneration++;
+}
+
+// Wait until the output ringbuffer has room for "space" bytes.
+static void jackWaitOut( JackMidiData *data, size_t space )
+{
+  while ( jack_ringbuffer_write_space( data->buff ) < space ) {
+#ifdef HAVE_SEMAPHORE
+    // Have jackProcessOut() post once it has read from the ringbuffer,
+    // and check again in case it did just before.  The timeout only
+    // guards against a server that stopped processing.
+    data->spaceWaiting = true;
+    if ( jack_ringbuffer_write_space( data->buff ) >= space ) break;
+    struct timespec ts;
+    clock_gettime( CLOCK_REALTIME, &ts );
+    ts.tv_nsec += 100000000;
+    if ( ts.tv_nsec >= 1000000000 ) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000;
+    }
+    sem_timedwait( &data->sem_space, &ts );
+#else
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+#endif
+  }
+}
+
+// Return the size of the events a message is sent in: the whole
+// message if an empty port buffer takes it as one event and it fits in
+// the ringbuffer, JACK_CHUNK_SIZE otherwise.  Until the process
+// callback has seen the port buffer, larger messages are split.
+static size_t jackChunkSize( JackMidiData *data, size_t size )
+{
+  size_t limit = data->maxEventSize.load( std::memory_order_relaxed );
+  if ( limit == 0 ) limit = JACK_CHUNK_SIZE;
+  size_t room = (size_t) data->buffMaxWrite;
+  limit = std::min( limit, room > sizeof( JackOutputEvent ) ? room - sizeof( JackOutputEvent ) : 1 );
+  if ( size <= limit ) return size;
+  return std::max( std::min( limit, (size_t) JACK_CHUNK_SIZE ), (size_t) 1 );
+}
+
+// Write a message to the output ringbuffer, to be sent at the JACK
+// time "time", or in the next cycle if it is zero.  A message too large
+// for one event is written in chunks, each sent as an event of its
+// own, as the process callback drains the ringbuffer.
+static void jackWriteOut( JackMidiData *data, const unsigned char *message, size_t size, jack_time_t time )
+{
+  JackOutputEvent header;
+  header.time = time;
+  size_t chunk = jackChunkSize( data, size );
+
+  size_t written = 0;
+  do {
+    header.size = static_cast<unsigned int>( std::min( chunk, size - written ) );
+    if ( jack_ringbuffer_write_space( data->buff ) < sizeof( header ) + header.size ) {
+      data->overruns++;
+      jackWaitOut( data, sizeof( header ) + header.size );
+    }
+    jack_ringbuffer_write( data->buff, ( char * ) &header, sizeof( header ) );
+    jack_ringbuffer_write( data->buff, ( const char * ) message + written, header.size );
+    jackTrackFill( data );
+    written += header.size;
+  } while ( written < size );
 }
 
 void MidiOutJack :: sendMessage( const unsigned char *message, size_t size )
 {
-  int nBytes = static_cast<int>(size);
+  JackMidiData *data = static_cast<JackMidiData *> (apiData_);
+  jackWriteOut( data, message, size, 0 );
+}
+
+void MidiOutJack :: sendMessageAt( int64_t monotonicTime, const unsigned char *message, size_t size )
+{
   JackMidiData *data = static_cast<JackMidiData *> (apiData_);
 
-  if ( size + sizeof(nBytes) > (size_t) data->buffMaxWrite )
-      return;
+  // Messages due in the past are placed like untimed ones anyway.
+  int64_t time = ( monotonicTime - data->monotonicOffset ) / 1000;
+  jackWriteOut( data, message, size, (jack_time_t) std::max( time, (int64_t) 0 ) );
+}
+
+bool MidiOutJack :: trySendMessage( const unsigned char *message, size_t size )
+{
+  JackMidiData *data = static_cast<JackMidiData *> (apiData_);
+
+  if ( size == 0 ) {
+    errorString_ = "MidiOutJack::trySendMessage: message argument is empty!";
+    error( RtMidiError::WARNING, errorString_ );
+    return true;
+  }
+
+  // The space taken by the message, with the header of each chunk.  A
+  // message that never fits is an error, lest the caller retry forever.
+  size_t chunk = jackChunkSize( data, size );
+  size_t space = size + ( ( size + chunk - 1 ) / chunk ) * sizeof( JackOutputEvent );
+  if ( space > (size_t) data->buffMaxWrite ) {
+    errorString_ = "MidiOutJack::trySendMessage: message larger than the output ringbuffer, use sendMessage().";
+    error( RtMidiError::INVALID_PARAMETER, errorString_ );
+    return false;
+  }
+  if ( jack_ringbuffer_write_space( data->buff ) < space ) {
+    data->overruns++;
+    return false;
+  }
+
+  jackWriteOut( data, message, size, 0 );
+  return true;
+}
+
+void MidiOutJack :: setSystemBufferSize( unsigned int bufferSize, unsigned int )
+{
+  JackMidiData *data = static_cast<JackMidiData *> (apiData_);
+  if ( bufferSize == 0 ) return;
+  // A ringbuffer keeps one byte free, and must hold a 1-byte chunk.
+  if ( bufferSize < sizeof( JackOutputEvent ) + 2 ) {
+    errorString_ = "MidiOutJack::setSystemBufferSize: the ringbuffer size is too small for a message.";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+  if ( data->port ) {
+    errorString_ = "MidiOutJack::setSystemBufferSize: the ringbuffer cannot be resized while a port is open.";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  jack_ringbuffer_t *buff = jack_ringbuffer_create( bufferSize );
+  if ( !buff ) {
+    errorString_ = "MidiOutJack::setSystemBufferSize: error creating the output ringbuffer.";
+    error( RtMidiError::MEMORY_ERROR, errorString_ );
+    return;
+  }
+
+  // Without a port, the process callback leaves the ringbuffer alone.
+  // Messages sent before a port was opened are discarded.
+  if ( data->buff ) jack_ringbuffer_free( data->buff );
+  data->buff = buff;
+  data->buffMaxWrite = (int) jack_ringbuffer_write_space( buff );
+  data->buffPeak = 0;
+}
+
+unsigned long MidiOutJack :: getOverrunCount( void )
+{
+  JackMidiData *data = static_cast<JackMidiData *> (apiData_);
+  return data->overruns.load();
+}
 
-  while ( jack_ringbuffer_write_space(data->buff) < sizeof(nBytes) + size )
-      sched_yield();
+unsigned int MidiOutJack :: getSystemBufferFill( void )
+{
+  JackMidiData *data = static_cast<JackMidiData *> (apiData_);
+  return data->buff ? (unsigned int) jack_ringbuffer_read_space( data->buff ) : 0;
+}
 
-  // Write full message to buffer
-  jack_ringbuffer_write( data->buff, ( char * ) &nBytes, sizeof( nBytes ) );
-  jack_ringbuffer_write( data->buff, ( const char * ) message, nBytes );
+unsigned int MidiOutJack :: getSystemBufferPeak( void )
+{
+  JackMidiData *data = static_cast<JackMidiData *> (apiData_);
+  return data->buffPeak.load();
 }
 
 #endif  // __UNIX_JACK__
@@ -4648,10 +7546,8 @@ extern "C" void EMSCRIPTEN_KEEPALIVE rtmidi_onMidiMessageProc( MidiInApi::RtMidi
   message.bytes.resize(message.bytes.size() + length);
   memcpy(message.bytes.data(), inputBytes, length);
   // FIXME: handle timestamp
-  if ( data->usingCallback ) {
-    RtMidiIn::RtMidiCallback callback = (RtMidiIn::RtMidiCallback) data->userCallback;
-    callback( message.timeStamp, &message.bytes, data->userData );
-  }
+  if ( data->usingCallback )
+    data->deliver( message );
 }
 
 void MidiInWeb::openPort( unsigned int portNumber, const std::string &portName )
@@ -5160,12 +8056,12 @@ void* MidiInAndroid :: pollMidi(void* context) {
       auto message = self->inputData_.message;
 
       if (self->inputData_.firstMessage == true) {
-        message.timeStamp = 0.0;
+        message.delta = RtMidiIn::Duration( 0 );
         self->inputData_.firstMessage = false;
       } else {
-        message.timeStamp = (timestamp * 0.000001) - self->lastTime;
+        message.delta = RtMidiIn::Duration( timestamp - self->lastTime );
       }
-      self->lastTime = (timestamp * 0.000001);
+      self->lastTime = timestamp;
 
       if (!continueSysex) message.bytes.clear();
 
@@ -5177,13 +8073,7 @@ void* MidiInAndroid :: pollMidi(void* context) {
       }
 
       if (!continueSysex) {
-        if (self->inputData_.usingCallback) {
-          auto callback = (RtMidiIn::RtMidiCallback) self->inputData_.userCallback;
-          callback(message.timeStamp, &message.bytes, self->inputData_.userData);
-        } else {
-          if (!self->inputData_.queue.push(message))
-            std::cerr << "\nMidiInAndroid: message queue limit reached!!\n\n";
-        }
+        self->inputData_.deliver(message);
       }
     }
   }
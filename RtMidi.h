@@ -77,6 +77,9 @@
                         "." RTMIDI_TOSTRING(RTMIDI_VERSION_PATCH)
 #endif
 
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
 #include <exception>
 #include <iostream>
 #include <string>
@@ -168,6 +171,19 @@ class RTMIDI_DLL_PUBLIC RtMidi
     NUM_APIS        /*!< Number of values in this enum. */
   };
 
+  //! How a port changed, see setPortCallback().
+  enum PortChange {
+    PORT_ADDED,    /*!< The port appeared. */
+    PORT_REMOVED   /*!< The port disappeared. */
+  };
+
+  //! User callback function type for port changes.
+  /*!
+    \e portName is the name that getPortName() reports, or reported,
+    for the port.
+  */
+  typedef void (*RtMidiPortCallback)( PortChange change, const std::string &portName, void *userData );
+
   //! A static function to determine the current RtMidi version.
   static std::string getVersion( void ) throw();
 
@@ -202,6 +218,28 @@ class RTMIDI_DLL_PUBLIC RtMidi
   */
   static RtMidi::Api getCompiledApiByName( const std::string &name );
 
+  //! Make instances created from now on share a single client of the MIDI API.
+  /*!
+    By default every RtMidiIn and RtMidiOut instance is a client of
+    its own.  In shared client mode, the instances of an API that
+    supports it open their ports on one client of the process, whose
+    single input thread delivers the messages of every port.  With
+    ALSA, input instances then share one sequencer client, queue and
+    dispatcher thread instead of having one each.  With JACK, input
+    and output instances register their ports on one JACK client,
+    and a single process callback services all of them in each
+    cycle.  The client takes
+    the name of the first instance and stays open until the last one
+    sharing it is destroyed.  Setting a client name, or input thread
+    options, through any of these instances applies to the shared
+    client.  Ports must not be opened or closed from within an input
+    callback in this mode.
+  */
+  static void setSharedClient( bool shared );
+
+  //! Returns true if instances created from now on share a client (see setSharedClient()).
+  static bool isSharedClient( void );
+
   //! Pure virtual openPort() function.
   virtual void openPort( unsigned int portNumber = 0, const std::string &portName = std::string( "RtMidi" ) ) = 0;
 
@@ -220,6 +258,86 @@ class RTMIDI_DLL_PUBLIC RtMidi
   void setClientName( const std::string &clientName );
   void setPortName( const std::string &portName );
 
+  //! Set the sizes of the buffers that the MIDI API keeps for this instance.
+  /*!
+    With ALSA, \e bufferSize is the size in bytes of the sequencer
+    client's input buffer for RtMidiIn, or output buffer for
+    RtMidiOut, through which events are read or written in bulk.  \e
+    poolSize is the number of events the sequencer holds for the
+    client: received events not read yet for input, events not
+    delivered yet for output.  A large SysEx dump arrives as many
+    events of up to 256 bytes, and needs a larger input pool to be
+    received without an overrun.  A size of zero keeps the current
+    size.  Resizing the input buffer or pool discards pending input,
+    and in shared client mode resizes them for all inputs.  With
+    JACK, \e bufferSize is the size in bytes of the ringbuffer
+    between the process callback and the input dispatch thread for
+    RtMidiIn, or between sendMessage() and the process callback for
+    RtMidiOut, rounded up to a power of two (16384 by default), and \e
+    poolSize is not used.  The ringbuffer can only be resized while no
+    port is open, best right after construction, and a size too small
+    for one message with its header is refused with a warning.  Other APIs report a
+    warning.
+  */
+  void setSystemBufferSize( unsigned int bufferSize, unsigned int poolSize );
+
+  //! Returns the number of times the buffers of the MIDI API overran.
+  /*!
+    With ALSA, this counts the overruns of the sequencer's input pool
+    for RtMidiIn, each of which loses the events held in the pool, and
+    the messages that could not be sent because the output pool was
+    full for RtMidiOut.  With JACK, it counts the input events dropped
+    because the ringbuffer between the process callback and the input
+    dispatch thread was full, and the output messages that found the
+    ringbuffer full, either waiting for room or refused by
+    trySendMessage().  Other APIs return 0.
+  */
+  unsigned long getOverrunCount( void );
+
+  //! Returns the number of events that the MIDI API reports as lost.
+  /*!
+    With ALSA, this is the sequencer's count of events that could not
+    be delivered to the client.  Other APIs return 0.
+  */
+  unsigned long getLostEventCount( void );
+
+  //! Returns the number of bytes currently held in the buffer between the application and the MIDI API.
+  /*!
+    With JACK, this is the fill level of the ringbuffer sized with
+    setSystemBufferSize().  Along with getSystemBufferPeak() and
+    getOverrunCount(), it tells whether the ringbuffer is large enough
+    for the traffic.  Other APIs return 0.
+  */
+  unsigned int getSystemBufferFill( void );
+
+  //! Returns the largest number of bytes held in the buffer between the application and the MIDI API at once.
+  /*!
+    The peak is reset when the buffer is resized.  Only JACK keeps it,
+    other APIs return 0.
+  */
+  unsigned int getSystemBufferPeak( void );
+
+  //! Set a callback function to be invoked when a port appears or disappears.
+  /*!
+    The callback learns of the ports that this instance can open, that
+    is the ports getPortName() lists, as they come and go, without
+    polling getPortCount().  A renamed port is reported as removed and
+    added again.  It is invoked from a thread of the API: the ALSA
+    backend follows the sequencer's System:Announce port and the JACK
+    backend the server's port registrations.  The callback can always
+    query ports.  With ALSA, no lock of RtMidi is held while it runs,
+    so it can also open and close ports and create and delete
+    instances, this one included, and set or remove port callbacks.
+    With JACK, it runs in the notification thread of the JACK client,
+    which may not close that client or wait for it: the callback must
+    not change the port callback of this instance, delete this instance
+    or open and close its ports.  In shared client mode, it can create
+    and delete other instances.  Passing NULL removes the callback;
+    once setPortCallback() returns, the old callback is no longer
+    invoked.  Other APIs report a warning.
+  */
+  void setPortCallback( RtMidiPortCallback callback = NULL, void *userData = 0 );
+
   //! Returns true if a port is open and false if not.
   /*!
       Note that this only applies to connections made with the openPort()
@@ -277,16 +395,141 @@ class RTMIDI_DLL_PUBLIC RtMidi
 class RTMIDI_DLL_PUBLIC RtMidiIn : public RtMidi
 {
  public:
+  //! A std::chrono clock on the timebase of getMonotonicTime().
+  /*!
+    Message times are kept as integer nanoseconds from the API to the
+    application.  The Duration and TimePoint types of this clock carry
+    them without conversion, while the double timeStamp arguments in
+    seconds are computed from them when a message is passed on.
+  */
+  struct Clock {
+    typedef std::chrono::nanoseconds duration;
+    typedef duration::rep rep;
+    typedef duration::period period;
+    typedef std::chrono::time_point<Clock> time_point;
+    static const bool is_steady = true;
+    static time_point now() { return time_point( duration( getMonotonicTime() ) ); }
+  };
+
+  //! Time elapsed between two messages, in integer nanoseconds.
+  typedef Clock::duration Duration;
+
+  //! Absolute time of a message, in integer nanoseconds on the timebase of getMonotonicTime().
+  typedef Clock::time_point TimePoint;
+
   //! User callback function type definition.
   typedef void (*RtMidiCallback)( double timeStamp, std::vector<unsigned char> *message, void *userData );
 
+  //! User callback function type receiving the message bytes without copying them into a vector.
+  /*!
+    The bytes are only valid for the duration of the call.
+  */
+  typedef void (*RtMidiRawCallback)( double timeStamp, const unsigned char *message, size_t size, void *userData );
+
+  //! Timing information about an incoming MIDI message.
+  struct MessageInfo {
+    //! Time in seconds elapsed since the previous message (zero for the first one).
+    double timeStamp;
+
+    //! Absolute time of the message in nanoseconds, on the timebase of getMonotonicTime().
+    int64_t monotonicTime;
+
+    //! Position of the message in the audio stream, in frames, or -1 if unknown.
+    /*!
+      With JACK, this is the frame time of the event within its
+      process cycle, that is jack_last_frame_time() plus the event's
+      offset, which wraps around like a jack_nframes_t.  It is only
+      passed to callback functions; messages read from the queue
+      return -1.
+    */
+    int64_t frameTime;
+
+    //! Time of the message in microseconds on the clock of the API, or -1 if unknown.
+    /*!
+      With JACK, this is the frame time converted with
+      jack_frames_to_time(), as a jack_time_t.  Like the frame time,
+      it is only passed to callback functions.
+    */
+    int64_t apiTime;
+
+    //! Time elapsed since the previous message, from which \e timeStamp is computed.
+    Duration delta;
+
+    //! Absolute time of the message, the same as \e monotonicTime.
+    TimePoint time;
+  };
+
+  //! User callback function type receiving the message bytes along with their timing information.
+  /*!
+    The bytes are only valid for the duration of the call.
+  */
+  typedef void (*RtMidiInfoCallback)( const MessageInfo &info, const unsigned char *message, size_t size, void *userData );
+
+  //! User callback function type receiving several incoming MIDI messages at once.
+  /*!
+    The \e count messages are stored back to back in \e bytes: message
+    i spans bytes[offsets[i]] to bytes[offsets[i+1]] and was received
+    at timeStamps[i] (delta time in seconds) and monotonicTimes[i]
+    (see MessageInfo).  The arrays are only valid for the duration of
+    the call.
+  */
+  typedef void (*RtMidiBatchCallback)( size_t count, const unsigned char *bytes, const size_t *offsets,
+                                       const double *timeStamps, const int64_t *monotonicTimes, void *userData );
+
+  //! User callback function type receiving several incoming MIDI messages at once with integer times.
+  /*!
+    This works like RtMidiBatchCallback, except that message i was
+    received deltas[i] after the previous message, at times[i].
+  */
+  typedef void (*RtMidiTimedBatchCallback)( size_t count, const unsigned char *bytes, const size_t *offsets,
+                                            const Duration *deltas, const TimePoint *times, void *userData );
+
+  //! What to do with incoming messages when the input queue is full.
+  enum QueueOverflowPolicy {
+    QUEUE_DROP_NEWEST,  /*!< Discard the incoming message (default). */
+    QUEUE_DROP_OLDEST,  /*!< Discard the oldest queued message to make room. */
+    QUEUE_GROW          /*!< Enlarge the queue up to a size cap, then discard incoming messages. */
+  };
+
+  //! Scheduling policies for the API's input thread, see setThreadScheduling().
+  enum ThreadScheduling {
+    THREAD_DEFAULT,  /*!< Time-sharing scheduling (SCHED_OTHER, default). */
+    THREAD_FIFO,     /*!< Real-time first-in, first-out scheduling (SCHED_FIFO). */
+    THREAD_RR        /*!< Real-time round-robin scheduling (SCHED_RR). */
+  };
+
+  //! MIDI message types, combined into a set for ignoreMessageTypes().
+  enum MessageType {
+    TYPE_NOTE_OFF         = 0x00001,  /*!< Note off (0x8n). */
+    TYPE_NOTE_ON          = 0x00002,  /*!< Note on (0x9n). */
+    TYPE_KEY_PRESSURE     = 0x00004,  /*!< Polyphonic key pressure (0xAn). */
+    TYPE_CONTROL_CHANGE   = 0x00008,  /*!< Control change (0xBn). */
+    TYPE_PROGRAM_CHANGE   = 0x00010,  /*!< Program change (0xCn). */
+    TYPE_CHANNEL_PRESSURE = 0x00020,  /*!< Channel pressure (0xDn). */
+    TYPE_PITCH_BEND       = 0x00040,  /*!< Pitch bend (0xEn). */
+    TYPE_SYSEX            = 0x00080,  /*!< System exclusive (0xF0). */
+    TYPE_TIME_CODE        = 0x00100,  /*!< MIDI time code quarter frame (0xF1). */
+    TYPE_SONG_POSITION    = 0x00200,  /*!< Song position pointer (0xF2). */
+    TYPE_SONG_SELECT      = 0x00400,  /*!< Song select (0xF3). */
+    TYPE_TUNE_REQUEST     = 0x00800,  /*!< Tune request (0xF6). */
+    TYPE_CLOCK            = 0x01000,  /*!< Timing clock (0xF8). */
+    TYPE_TICK             = 0x02000,  /*!< Timing tick (0xF9). */
+    TYPE_START            = 0x04000,  /*!< Start (0xFA). */
+    TYPE_CONTINUE         = 0x08000,  /*!< Continue (0xFB). */
+    TYPE_STOP             = 0x10000,  /*!< Stop (0xFC). */
+    TYPE_ACTIVE_SENSING   = 0x20000,  /*!< Active sensing (0xFE). */
+    TYPE_SYSTEM_RESET     = 0x40000   /*!< System reset (0xFF). */
+  };
+
   //! Default constructor that allows an optional api, client name and queue size.
   /*!
     An exception will be thrown if a MIDI system initialization
     error occurs.  The queue size defines the maximum number of
     messages that can be held in the MIDI queue (when not using a
-    callback function).  If the queue size limit is reached,
-    incoming messages will be ignored.
+    callback function).  It is rounded up to the next power of two.
+    If the queue size limit is reached, incoming messages are handled
+    according to the overflow policy, and each discarded message is
+    counted (see getDroppedMessageCount()).
 
     If no API argument is specified and multiple API support has been
     compiled, the default order of use is ALSA, JACK (Linux) and CORE,
@@ -297,10 +540,15 @@ class RTMIDI_DLL_PUBLIC RtMidiIn : public RtMidi
                       will be used to group the ports that are created
                       by the application.
     \param queueSizeLimit An optional size of the MIDI input queue can be specified.
+    \param overflowPolicy An optional policy for a full input queue can be specified.
+    \param queueSizeCap With QUEUE_GROW, the size the queue may grow to.
+                        If zero, 16 times \e queueSizeLimit is used.
   */
   RtMidiIn( RtMidi::Api api=UNSPECIFIED,
             const std::string& clientName = "RtMidi Input Client",
-            unsigned int queueSizeLimit = 100 );
+            unsigned int queueSizeLimit = 100,
+            QueueOverflowPolicy overflowPolicy = QUEUE_DROP_NEWEST,
+            unsigned int queueSizeCap = 0 );
 
   RtMidiIn(RtMidiIn&& other) noexcept : RtMidi(std::move(other)) { }
 
@@ -343,6 +591,42 @@ class RTMIDI_DLL_PUBLIC RtMidiIn : public RtMidi
   */
   void setCallback( RtMidiCallback callback, void *userData = 0 );
 
+  //! Set a callback function receiving the bytes of incoming MIDI messages directly.
+  /*!
+    This works like the vector version of setCallback(), except that
+    the callback is passed a pointer into the API's own input buffer
+    and a length, so that no std::vector is filled for each message.
+    Only one callback function, of either type, can be set at a time.
+
+    \param callback A callback function must be given.
+    \param userData Optionally, a pointer to additional data can be
+                    passed to the callback function whenever it is called.
+  */
+  void setCallback( RtMidiRawCallback callback, void *userData = 0 );
+
+  //! Set a callback function receiving incoming MIDI messages with their absolute time.
+  /*!
+    This works like the raw version of setCallback(), except that the
+    callback is also passed the absolute time of the message (see
+    MessageInfo).  Only one callback function, of any type, can be set
+    at a time.
+  */
+  void setCallback( RtMidiInfoCallback callback, void *userData = 0 );
+
+  //! Set a callback function receiving bursts of incoming MIDI messages in one call.
+  /*!
+    With the ALSA and JACK APIs, all the messages read on one wakeup
+    of the input thread (or in one JACK process cycle) are passed to
+    a single invocation of the callback, so that they can be handled
+    together, e.g. under one lock.  Other APIs pass one message at a
+    time.  Only one callback function, of any type, can be set at a
+    time.
+  */
+  void setCallback( RtMidiBatchCallback callback, void *userData = 0 );
+
+  //! Set a callback function receiving bursts of incoming MIDI messages with their times as Duration and TimePoint values.
+  void setCallback( RtMidiTimedBatchCallback callback, void *userData = 0 );
+
   //! Cancel use of the current callback function (if one exists).
   /*!
     Subsequent incoming MIDI messages will be written to the queue
@@ -380,10 +664,24 @@ class RTMIDI_DLL_PUBLIC RtMidiIn : public RtMidi
     during message input because of their relative high data rates.
     MIDI sysex messages are ignored by default as well.  Variable
     values of "true" imply that the respective message type will be
-    ignored.
+    ignored.  MIDI timing covers time code, clock and tick messages.
+    This replaces any set given to ignoreMessageTypes().
   */
   void ignoreTypes( bool midiSysex = true, bool midiTime = true, bool midiSense = true );
 
+  //! Specify the set of MIDI message types to ignore during input.
+  /*!
+    \e types is a combination of MessageType values, and replaces the
+    set of ignored types, including the ones given to ignoreTypes().
+    With ALSA, the sequencer is told not to deliver the corresponding
+    events at all, so that a flood of ignored messages, such as the
+    clock of a MIDI master, does not wake up the input thread.
+  */
+  void ignoreMessageTypes( unsigned int types );
+
+  //! Returns the set of MessageType values currently ignored during input.
+  unsigned int getIgnoredMessageTypes( void );
+
   //! Fill the user-provided vector with the data bytes for the next available MIDI message in the input queue and return the event delta-time in seconds.
   /*!
     This function returns immediately whether a new message is
@@ -394,6 +692,119 @@ class RTMIDI_DLL_PUBLIC RtMidiIn : public RtMidi
   */
   double getMessage( std::vector<unsigned char> *message );
 
+  //! Fill the user-provided vector with the next available MIDI message and \e info with its timing, and return the event delta-time in seconds.
+  /*!
+    This works like the other version of getMessage().  If no message
+    is available, \e info is left unchanged.
+  */
+  double getMessage( std::vector<unsigned char> *message, MessageInfo *info );
+
+  //! Move as many queued MIDI messages as fit into user-provided arrays and return the number of messages retrieved.
+  /*!
+    This function drains the input queue in a single pass and returns
+    immediately, whether messages are available or not.  The data
+    bytes of all retrieved messages are stored back to back in \e
+    bytes.  Message \e i occupies bytes[offsets[i]] up to, but not
+    including, bytes[offsets[i+1]], so \e offsets must have room for
+    \e maxMessages + 1 entries.  If \e timeStamps is not NULL, it
+    receives the delta-time in seconds of each message, and if \e
+    monotonicTimes is not NULL, it receives the absolute time of each
+    message (see MessageInfo).  Retrieval
+    stops when \e maxMessages messages have been returned, the queue
+    is empty, or the next message does not fit in the remaining \e
+    bytesSize bytes, in which case it stays in the queue.  An
+    exception is thrown if an error occurs during message retrieval or
+    an input connection was not previously established.
+  */
+  size_t getMessages( unsigned char *bytes, size_t bytesSize, size_t *offsets,
+                      double *timeStamps, size_t maxMessages, int64_t *monotonicTimes = 0 );
+
+  //! Move as many queued MIDI messages as fit into user-provided arrays, with their times as Duration and TimePoint values.
+  /*!
+    This works like the other version of getMessages().  If \e deltas
+    is not NULL, it receives the time elapsed since the previous
+    message, and if \e times is not NULL, the absolute time of each
+    message.
+  */
+  size_t getMessages( unsigned char *bytes, size_t bytesSize, size_t *offsets,
+                      size_t maxMessages, Duration *deltas, TimePoint *times = 0 );
+
+  //! Return the current time in nanoseconds on the timebase of MessageInfo::monotonicTime.
+  /*!
+    This is CLOCK_MONOTONIC on Linux, and std::chrono::steady_clock
+    (the host time of Core MIDI on macOS) elsewhere.  Incoming messages
+    are stamped by the API when it provides a time (the ALSA queue time
+    and the JACK time are converted to this timebase), or when they are
+    received otherwise.
+  */
+  static int64_t getMonotonicTime( void );
+
+  //! Block until a MIDI message is available in the input queue or \e timeout seconds have elapsed.
+  /*!
+    Returns true if a message can be retrieved with getMessage() or
+    getMessages(), or false if the timeout expired first.  A negative
+    timeout waits indefinitely.  This function cannot be used while a
+    callback function is set.
+  */
+  bool waitForMessage( double timeout = -1.0 );
+
+  //! Return a file descriptor that becomes readable when MIDI messages are queued, or -1 if not supported.
+  /*!
+    The descriptor can be added to a poll(), select() or epoll set to
+    integrate MIDI input in an existing event loop.  It stays readable
+    until the queue has been drained with getMessage() or
+    getMessages(); the descriptor must not be read, written or closed
+    by the caller.  It is only available on POSIX systems and only
+    signals messages delivered to the queue, not to a callback
+    function.
+  */
+  int getPollDescriptor( void );
+
+  //! Return the number of incoming messages discarded because the input queue was full.
+  unsigned long getDroppedMessageCount( void );
+
+  //! Return the largest number of messages that have been held in the input queue at once.
+  unsigned int getQueueHighWaterMark( void );
+
+  //! Set the scheduling policy and priority of the thread reading MIDI input.
+  /*!
+    Real-time scheduling keeps the input thread from being preempted
+    by other load.  The priority is clamped to the range allowed for
+    the policy.  If the process lacks the privileges (see
+    RLIMIT_RTPRIO), a warning is reported through the error callback
+    and the thread keeps its default scheduling.  The setting applies
+    to the running thread and to threads started by later calls to
+    openPort() or openVirtualPort().  Only the Linux ALSA API runs its
+    own input thread; other APIs report a warning.
+  */
+  void setThreadScheduling( ThreadScheduling scheduling, int priority = 0 );
+
+  //! Restrict the thread reading MIDI input to the given CPUs (an empty list allows all of them).
+  /*!
+    Failures are reported as warnings through the error callback, as
+    for setThreadScheduling().
+  */
+  void setThreadAffinity( const std::vector<unsigned int> &cpus );
+
+  //! Set the name of the thread reading MIDI input, as shown by debuggers and ps (at most 15 characters are used).
+  void setThreadName( const std::string &name );
+
+  //! Deliver MIDI input from the real-time thread of the API instead of a separate thread (JACK only).
+  /*!
+    By default, the JACK process callback only copies incoming events
+    into a preallocated ringbuffer, and a separate thread assembles
+    them into messages and passes them to the callback function or the
+    queue, so that nothing is allocated or locked in JACK's real-time
+    thread.  With real-time delivery, messages are passed on from the
+    process callback itself, which saves a thread switch but requires
+    the callback function to be real-time safe: it must not block,
+    allocate memory or make system calls.  SysEx messages larger than
+    the buffer size set with setBufferSize() may still allocate.  This
+    must be called before a port is opened.  Other APIs report a
+    warning when real-time delivery is requested.
+  */
+  void setRealtimeDelivery( bool realtime );
+
   //! Set an error callback function to be invoked when an error has occurred.
   /*!
     The callback function will be called whenever an error has occurred. It is best
@@ -415,7 +826,8 @@ class RTMIDI_DLL_PUBLIC RtMidiIn : public RtMidi
   virtual void setBufferSize( unsigned int size, unsigned int count );
 
  protected:
-  void openMidiApi( RtMidi::Api api, const std::string &clientName, unsigned int queueSizeLimit );
+  void openMidiApi( RtMidi::Api api, const std::string &clientName, unsigned int queueSizeLimit,
+                    QueueOverflowPolicy overflowPolicy, unsigned int queueSizeCap );
 };
 
 /**********************************************************************/
@@ -435,6 +847,14 @@ class RTMIDI_DLL_PUBLIC RtMidiIn : public RtMidi
 class RTMIDI_DLL_PUBLIC RtMidiOut : public RtMidi
 {
  public:
+
+  //! When sent messages are written out to the MIDI API, see setFlushPolicy().
+  enum FlushPolicy {
+    FLUSH_IMMEDIATE,  /*!< Write out each message as soon as it is sent. */
+    FLUSH_BATCH,      /*!< Write out the messages of each sendMessage() or sendMessages() call at once (default). */
+    FLUSH_DEFERRED    /*!< Hold messages back for up to a maximum latency, or until flush() is called. */
+  };
+
   //! Default constructor that allows an optional client name.
   /*!
     An exception will be thrown if a MIDI system initialization error occurs.
@@ -505,13 +925,91 @@ class RTMIDI_DLL_PUBLIC RtMidiOut : public RtMidi
   //! Immediately send a single message out an open MIDI output port.
   /*!
       An exception is thrown if an error occurs during output or an
-      output connection was not previously established.
+      output connection was not previously established.  With JACK,
+      the call waits while the output ringbuffer is full, and a
+      message larger than the port buffer takes as one event (or than
+      the ringbuffer) is split into chunks of 256 bytes, sent as
+      separate events over as many process cycles as it takes, so a
+      large SysEx message may arrive as fragments.  Messages that
+      cannot be sent at all are counted by getOverrunCount().
 
       \param message A pointer to the MIDI message as raw bytes
       \param size    Length of the MIDI message in bytes
   */
   void sendMessage( const unsigned char *message, size_t size );
 
+  //! Send a single message out an open MIDI output port if that does not require waiting.
+  /*!
+      Returns true if the message was sent, or false if the API would
+      have to wait for room in its output buffer, in which case nothing
+      is sent.  With JACK, a message larger than the whole output
+      ringbuffer cannot be sent this way; it is reported as an
+      INVALID_PARAMETER error.  An empty message is not sent and is
+      reported with a warning.
+      A large SysEx message may arrive as fragments, as with
+      sendMessage().
+      APIs that do not buffer output send the message as sendMessage()
+      does and return true.
+  */
+  bool trySendMessage( const unsigned char *message, size_t size );
+
+  //! Send a single message out an open MIDI output port if that does not require waiting, see above.
+  bool trySendMessage( const std::vector<unsigned char> *message );
+
+  //! Send a single message out an open MIDI output port at a given time.
+  /*!
+      \e monotonicTime is the time in nanoseconds at which the message
+      is due, on the timebase of RtMidiIn::getMonotonicTime().  With
+      ALSA, the message is scheduled on a sequencer queue of the
+      output client, which delivers it on time, so a sequencer can
+      send a lookahead window of messages in advance.  With JACK, the
+      message is held in the output ringbuffer until the process cycle
+      in which it is due, and placed at its frame within the cycle;
+      messages leave in the order they were sent, so one due earlier
+      than a message sent before it waits for that message.  Messages
+      due in the past are delivered immediately.  Other APIs send the
+      message immediately and report a warning.  An exception is
+      thrown if an error occurs during output or an output connection
+      was not previously established.
+  */
+  void sendMessageAt( int64_t monotonicTime, const unsigned char *message, size_t size );
+
+  //! Send a single message out an open MIDI output port at a given time, see above.
+  void sendMessageAt( int64_t monotonicTime, const std::vector<unsigned char> *message );
+
+  //! Send a single message out an open MIDI output port at a given RtMidiIn::TimePoint, see above.
+  void sendMessageAt( RtMidiIn::TimePoint time, const unsigned char *message, size_t size );
+
+  //! Send a single message out an open MIDI output port at a given RtMidiIn::TimePoint, see above.
+  void sendMessageAt( RtMidiIn::TimePoint time, const std::vector<unsigned char> *message );
+
+  //! Send several messages out an open MIDI output port at once.
+  /*!
+      The \e count messages are stored back to back in \e bytes:
+      message i spans bytes[offsets[i]] to bytes[offsets[i+1]], the
+      layout received by an RtMidiIn::RtMidiBatchCallback.  With ALSA,
+      all messages are written out to the sequencer in a single system
+      call (see setFlushPolicy()).  With other APIs, they are sent one
+      by one.  An exception is thrown if an error occurs during output
+      or an output connection was not previously established.
+  */
+  void sendMessages( const unsigned char *bytes, const size_t *offsets, size_t count );
+
+  //! Set when sent messages are written out to the MIDI API.
+  /*!
+      With FLUSH_DEFERRED, messages are held back until \e maxLatency
+      seconds after the first one held back was sent, until the
+      output buffer is full (see setSystemBufferSize()) or until
+      flush() is called, which lets a burst of sendMessage() calls
+      share one system call at the cost of that latency.  This is
+      only supported by ALSA, other APIs send each message
+      immediately and report a warning.
+  */
+  void setFlushPolicy( FlushPolicy policy, double maxLatency = 0.001 );
+
+  //! Write out any message held back by the flush policy.
+  void flush( void );
+
   //! Set an error callback function to be invoked when an error has occurred.
   /*!
     The callback function will be called whenever an error has occurred. It is best
@@ -552,6 +1050,11 @@ class RTMIDI_DLL_PUBLIC MidiApi
 
   virtual unsigned int getPortCount( void ) = 0;
   virtual std::string getPortName( unsigned int portNumber ) = 0;
+  virtual void setSystemBufferSize( unsigned int bufferSize, unsigned int poolSize );
+  virtual unsigned long getOverrunCount( void );
+  virtual unsigned long getLostEventCount( void );
+  virtual unsigned int getSystemBufferFill( void );
+  virtual unsigned int getSystemBufferPeak( void );
 
   inline bool isPortOpen() const { return connected_; }
   void setErrorCallback( RtMidiErrorCallback errorCallback, void *userData );
@@ -559,6 +1062,8 @@ class RTMIDI_DLL_PUBLIC MidiApi
   //! A basic error reporting function for RtMidi classes.
   void error( RtMidiError::Type type, std::string errorString );
 
+  virtual void setPortCallback( RtMidi::RtMidiPortCallback callback, void *userData );
+
 protected:
   virtual void initialize( const std::string& clientName ) = 0;
 
@@ -578,36 +1083,149 @@ class RTMIDI_DLL_PUBLIC MidiInApi : public MidiApi
   MidiInApi( unsigned int queueSizeLimit );
   virtual ~MidiInApi( void );
   void setCallback( RtMidiIn::RtMidiCallback callback, void *userData );
+  void setCallback( RtMidiIn::RtMidiRawCallback callback, void *userData );
+  void setCallback( RtMidiIn::RtMidiInfoCallback callback, void *userData );
+  void setCallback( RtMidiIn::RtMidiBatchCallback callback, void *userData );
+  void setCallback( RtMidiIn::RtMidiTimedBatchCallback callback, void *userData );
   void cancelCallback( void );
   virtual void ignoreTypes( bool midiSysex, bool midiTime, bool midiSense );
+  virtual void ignoreMessageTypes( unsigned int types );
+  unsigned int getIgnoredMessageTypes( void );
   virtual double getMessage( std::vector<unsigned char> *message );
+  virtual double getMessage( std::vector<unsigned char> *message, RtMidiIn::MessageInfo *info );
+  virtual size_t getMessages( unsigned char *bytes, size_t bytesSize, size_t *offsets,
+                              double *timeStamps, size_t maxMessages, int64_t *monotonicTimes );
+  virtual size_t getMessages( unsigned char *bytes, size_t bytesSize, size_t *offsets,
+                              size_t maxMessages, RtMidiIn::Duration *deltas, RtMidiIn::TimePoint *times );
+  virtual bool waitForMessage( double timeout );
+  virtual int getPollDescriptor( void );
+  void setQueueOverflowPolicy( RtMidiIn::QueueOverflowPolicy overflowPolicy, unsigned int queueSizeCap );
+  unsigned long getDroppedMessageCount( void );
+  unsigned int getQueueHighWaterMark( void );
   virtual void setBufferSize( unsigned int size, unsigned int count );
+  virtual void setThreadScheduling( RtMidiIn::ThreadScheduling scheduling, int priority );
+  virtual void setThreadAffinity( const std::vector<unsigned int> &cpus );
+  virtual void setThreadName( const std::string &name );
+  virtual void setRealtimeDelivery( bool realtime );
 
   // A MIDI structure used internally by the class to store incoming
   // messages.  Each message represents one and only one MIDI message.
   struct MidiMessage {
     std::vector<unsigned char> bytes;
 
-    //! Time in seconds elapsed since the previous message
-    double timeStamp;
+    //! Time elapsed since the previous message
+    RtMidiIn::Duration delta;
+
+    //! Absolute time, or zero to stamp the message when it is delivered
+    RtMidiIn::TimePoint time;
 
     // Default constructor.
     MidiMessage()
-      : bytes(0), timeStamp(0.0) {}
+      : bytes(0), delta(0), time() {}
   };
 
+  // A lock-free single-producer/single-consumer ring of incoming
+  // messages, written by the API input thread or callback and read by
+  // the thread calling getMessage().  The ring size is a power of two
+  // and the producer and consumer indices are kept on separate cache
+  // lines.  Slots are kept compact: short messages are stored inline,
+  // while longer ones (SysEx) are copied into a byte ring (the arena)
+  // that the consumer frees as it reads them.  A message that does not
+  // fit in the arena is kept in a spill vector of its slot instead, so
+  // neither side allocates once the queue has warmed up.  A consumer that finds
+  // the queue empty "arms" it, and the next push then signals a
+  // pollable descriptor (an eventfd on Linux, a pipe on other POSIX
+  // systems), so waiting costs no system calls while data is flowing.
+  //
+  // When the queue is full, the overflow policy decides what happens:
+  // the new message is dropped, the oldest queued message is dropped
+  // (the producer then advances the front index itself, and a consumer
+  // reading that slot announces it in readSlot so that it is not
+  // overwritten), or a larger ring segment is chained after the
+  // current one until the size cap is reached.  Indices run freely
+  // across segments; the consumer frees a segment once it has moved
+  // past it.
   struct MidiQueue {
-    unsigned int front;
-    unsigned int back;
-    unsigned int ringSize;
-    MidiMessage *ring;
+    enum { CACHE_LINE_SIZE = 64, INLINE_SIZE = 4, MIN_ARENA_SIZE = 8192, ARENA_BYTES_PER_SLOT = 16 };
+
+    // The size of a spilled message is flagged with this bit.
+    static const unsigned int SPILLED = 0x80000000u;
+
+    struct Slot {
+      RtMidiIn::Duration delta;
+      RtMidiIn::TimePoint time;
+      unsigned int size;
+      union {
+        unsigned char bytes[INLINE_SIZE];  // Messages of up to INLINE_SIZE bytes.
+        unsigned int offset;               // Arena position of longer messages.
+      };
+    };
+
+    struct Segment {
+      Slot *ring;
+      std::vector<unsigned char> *spill;  // One per slot, allocated on first use.
+      unsigned int size;
+      unsigned int mask;
+      unsigned int base;  // Index of the first message stored in this segment.
+      std::atomic<Segment *> next;
+      Segment( unsigned int size, unsigned int base );
+      ~Segment();
+    };
+
+    std::atomic<unsigned int> front;  // Written by the consumer (and by the producer when dropping the oldest).
+    std::atomic<unsigned int> readSlot;  // Slot being read by the consumer plus one, or zero.
+    Segment *head;                    // Segment holding the front, owned by the consumer.
+    std::atomic<unsigned int> arenaFront;  // Arena position freed by the consumer.
+    char frontPadding[CACHE_LINE_SIZE - 3 * sizeof(std::atomic<unsigned int>) - sizeof(Segment *)];
+    std::atomic<unsigned int> back;   // Written by the producer only.
+    std::atomic<unsigned int> highWaterMark;
+    std::atomic<unsigned long> dropped;
+    Segment *tail;                    // Segment holding the back, owned by the producer.
+    unsigned int arenaBack;           // Arena position written by the producer.
+    char backPadding[CACHE_LINE_SIZE - 3 * sizeof(std::atomic<unsigned int>) - sizeof(std::atomic<unsigned long>) - sizeof(Segment *)];
+    unsigned char *arena;             // Byte ring holding long messages.
+    unsigned int arenaSize;           // A power of two.
+    unsigned int ringSize;            // Initial ring size.
+    unsigned int sizeCap;             // Maximum total size with QUEUE_GROW.
+    RtMidiIn::QueueOverflowPolicy policy;
+    std::atomic<bool> waitable;  // Set once the wake-up descriptor exists.
+    std::atomic<bool> armed;  // Set while the consumer waits for a push.
+    int notifyFds[2];         // Read and write ends of the wake-up descriptor.
 
     // Default constructor.
     MidiQueue()
-      : front(0), back(0), ringSize(0), ring(0) {}
+      : front(0), readSlot(0), head(0), arenaFront(0), back(0), highWaterMark(0), dropped(0), tail(0), arenaBack(0),
+        arena(0), arenaSize(0), ringSize(0), sizeCap(0), policy(RtMidiIn::QUEUE_DROP_NEWEST), waitable(false), armed(false)
+    { notifyFds[0] = notifyFds[1] = -1; }
+    ~MidiQueue();
+    void init( unsigned int queueSizeLimit,
+               RtMidiIn::QueueOverflowPolicy overflowPolicy = RtMidiIn::QUEUE_DROP_NEWEST,
+               unsigned int queueSizeCap = 0 );
+    int pollDescriptor();
+    void arm();
+    void notify();
+    bool wait( double timeout );
+    bool push( const unsigned char *bytes, size_t size, RtMidiIn::Duration delta, RtMidiIn::TimePoint time );
+    bool push( const unsigned char *bytes, size_t size, double timeStamp, int64_t monotonicTime );
     bool push( const MidiMessage& );
-    bool pop( std::vector<unsigned char>*, double* );
+    bool pop( std::vector<unsigned char>*, RtMidiIn::Duration*, RtMidiIn::TimePoint *time = 0 );
+    bool pop( std::vector<unsigned char>*, double*, int64_t *monotonicTime = 0 );
+    size_t pop( unsigned char *bytes, size_t bytesSize, size_t *offsets,
+                size_t maxMessages, RtMidiIn::Duration *deltas, RtMidiIn::TimePoint *times = 0 );
+    size_t pop( unsigned char *bytes, size_t bytesSize, size_t *offsets,
+                double *timeStamps, size_t maxMessages, int64_t *monotonicTimes = 0 );
     unsigned int size( unsigned int *back=0, unsigned int *front=0 );
+
+   private:
+    void store( Slot &slot, Segment *segment, unsigned int index, const unsigned char *bytes, size_t size );
+    template <typename Delta, typename Time>
+    size_t popMessages( unsigned char *bytes, size_t bytesSize, size_t *offsets,
+                        size_t maxMessages, Delta *deltas, Time *times );
+    const Slot *peek( unsigned int index );
+    void copy( const Slot *slot, unsigned char *bytes );
+    bool release( unsigned int index );
+    MidiQueue( const MidiQueue& );
+    MidiQueue& operator=( const MidiQueue& );
   };
 
   // The RtMidiInData structure is used to pass private class data to
@@ -616,20 +1234,50 @@ class RTMIDI_DLL_PUBLIC MidiInApi : public MidiApi
     MidiQueue queue;
     MidiMessage message;
     unsigned char ignoreFlags;
+    unsigned int ignoredTypes; // RtMidiIn::MessageType values, see deliver()
     bool doInput;
     bool firstMessage;
     void *apiData;
     bool usingCallback;
     RtMidiIn::RtMidiCallback userCallback;
+    RtMidiIn::RtMidiRawCallback rawCallback;
+    RtMidiIn::RtMidiInfoCallback infoCallback;
+    RtMidiIn::RtMidiBatchCallback batchCallback;
+    RtMidiIn::RtMidiTimedBatchCallback timedBatchCallback;
     void *userData;
     bool continueSysex;
     unsigned int bufferSize;
     unsigned int bufferCount;
 
+    // Messages collected for the batch callback.  APIs that read
+    // input in bursts set "batching" and call flushBatch() at the end
+    // of each burst; otherwise every message is passed on by itself.
+    enum { MAX_BATCH = 256 };
+
+    // The types ignored by default, and the types that ignoreTypes()
+    // calls MIDI timing.
+    enum {
+      TIME_TYPES = RtMidiIn::TYPE_TIME_CODE | RtMidiIn::TYPE_CLOCK | RtMidiIn::TYPE_TICK,
+      DEFAULT_IGNORED_TYPES = RtMidiIn::TYPE_SYSEX | TIME_TYPES | RtMidiIn::TYPE_ACTIVE_SENSING
+    };
+    bool batching;
+    std::vector<unsigned char> batchBytes;
+    std::vector<size_t> batchOffsets;
+    std::vector<RtMidiIn::Duration> batchDeltas;
+    std::vector<RtMidiIn::TimePoint> batchTimes;
+    std::vector<double> batchTimeStamps;  // Converted for a RtMidiBatchCallback.
+    std::vector<int64_t> batchMonotonicTimes;
+
     // Default constructor.
     RtMidiInData()
-      : ignoreFlags(7), doInput(false), firstMessage(true), apiData(0), usingCallback(false),
-        userCallback(0), userData(0), continueSysex(false), bufferSize(1024), bufferCount(4) {}
+      : ignoreFlags(7), ignoredTypes(DEFAULT_IGNORED_TYPES), doInput(false), firstMessage(true), apiData(0), usingCallback(false),
+        userCallback(0), rawCallback(0), infoCallback(0), batchCallback(0), timedBatchCallback(0), userData(0), continueSysex(false),
+        bufferSize(1024), bufferCount(4), batching(false), batchOffsets(1, 0) {}
+
+    void deliver( const unsigned char *bytes, size_t size, RtMidiIn::Duration delta, RtMidiIn::TimePoint time,
+                  int64_t frameTime = -1, int64_t apiTime = -1 );
+    void deliver( MidiMessage &message );
+    void flushBatch();
   };
 
  protected:
@@ -643,6 +1291,11 @@ class RTMIDI_DLL_PUBLIC MidiOutApi : public MidiApi
   MidiOutApi( void );
   virtual ~MidiOutApi( void );
   virtual void sendMessage( const unsigned char *message, size_t size ) = 0;
+  virtual void sendMessages( const unsigned char *bytes, const size_t *offsets, size_t count );
+  virtual void sendMessageAt( int64_t monotonicTime, const unsigned char *message, size_t size );
+  virtual bool trySendMessage( const unsigned char *message, size_t size );
+  virtual void setFlushPolicy( RtMidiOut::FlushPolicy policy, double maxLatency );
+  virtual void flush( void );
 };
 
 // **************************************************************** //
@@ -657,11 +1310,28 @@ inline void RtMidiIn :: openVirtualPort( const std::string &portName ) { rtapi_-
 inline void RtMidiIn :: closePort( void ) { rtapi_->closePort(); }
 inline bool RtMidiIn :: isPortOpen() const { return rtapi_->isPortOpen(); }
 inline void RtMidiIn :: setCallback( RtMidiCallback callback, void *userData ) { static_cast<MidiInApi *>(rtapi_)->setCallback( callback, userData ); }
+inline void RtMidiIn :: setCallback( RtMidiRawCallback callback, void *userData ) { static_cast<MidiInApi *>(rtapi_)->setCallback( callback, userData ); }
+inline void RtMidiIn :: setCallback( RtMidiInfoCallback callback, void *userData ) { static_cast<MidiInApi *>(rtapi_)->setCallback( callback, userData ); }
+inline void RtMidiIn :: setCallback( RtMidiBatchCallback callback, void *userData ) { static_cast<MidiInApi *>(rtapi_)->setCallback( callback, userData ); }
+inline void RtMidiIn :: setCallback( RtMidiTimedBatchCallback callback, void *userData ) { static_cast<MidiInApi *>(rtapi_)->setCallback( callback, userData ); }
 inline void RtMidiIn :: cancelCallback( void ) { static_cast<MidiInApi *>(rtapi_)->cancelCallback(); }
 inline unsigned int RtMidiIn :: getPortCount( void ) { return rtapi_->getPortCount(); }
 inline std::string RtMidiIn :: getPortName( unsigned int portNumber ) { return rtapi_->getPortName( portNumber ); }
 inline void RtMidiIn :: ignoreTypes( bool midiSysex, bool midiTime, bool midiSense ) { static_cast<MidiInApi *>(rtapi_)->ignoreTypes( midiSysex, midiTime, midiSense ); }
+inline void RtMidiIn :: ignoreMessageTypes( unsigned int types ) { static_cast<MidiInApi *>(rtapi_)->ignoreMessageTypes( types ); }
+inline unsigned int RtMidiIn :: getIgnoredMessageTypes( void ) { return static_cast<MidiInApi *>(rtapi_)->getIgnoredMessageTypes(); }
 inline double RtMidiIn :: getMessage( std::vector<unsigned char> *message ) { return static_cast<MidiInApi *>(rtapi_)->getMessage( message ); }
+inline double RtMidiIn :: getMessage( std::vector<unsigned char> *message, MessageInfo *info ) { return static_cast<MidiInApi *>(rtapi_)->getMessage( message, info ); }
+inline size_t RtMidiIn :: getMessages( unsigned char *bytes, size_t bytesSize, size_t *offsets, double *timeStamps, size_t maxMessages, int64_t *monotonicTimes ) { return static_cast<MidiInApi *>(rtapi_)->getMessages( bytes, bytesSize, offsets, timeStamps, maxMessages, monotonicTimes ); }
+inline size_t RtMidiIn :: getMessages( unsigned char *bytes, size_t bytesSize, size_t *offsets, size_t maxMessages, Duration *deltas, TimePoint *times ) { return static_cast<MidiInApi *>(rtapi_)->getMessages( bytes, bytesSize, offsets, maxMessages, deltas, times ); }
+inline bool RtMidiIn :: waitForMessage( double timeout ) { return static_cast<MidiInApi *>(rtapi_)->waitForMessage( timeout ); }
+inline int RtMidiIn :: getPollDescriptor( void ) { return static_cast<MidiInApi *>(rtapi_)->getPollDescriptor(); }
+inline unsigned long RtMidiIn :: getDroppedMessageCount( void ) { return static_cast<MidiInApi *>(rtapi_)->getDroppedMessageCount(); }
+inline unsigned int RtMidiIn :: getQueueHighWaterMark( void ) { return static_cast<MidiInApi *>(rtapi_)->getQueueHighWaterMark(); }
+inline void RtMidiIn :: setThreadScheduling( ThreadScheduling scheduling, int priority ) { static_cast<MidiInApi *>(rtapi_)->setThreadScheduling( scheduling, priority ); }
+inline void RtMidiIn :: setThreadAffinity( const std::vector<unsigned int> &cpus ) { static_cast<MidiInApi *>(rtapi_)->setThreadAffinity( cpus ); }
+inline void RtMidiIn :: setThreadName( const std::string &name ) { static_cast<MidiInApi *>(rtapi_)->setThreadName( name ); }
+inline void RtMidiIn :: setRealtimeDelivery( bool realtime ) { static_cast<MidiInApi *>(rtapi_)->setRealtimeDelivery( realtime ); }
 inline void RtMidiIn :: setErrorCallback( RtMidiErrorCallback errorCallback, void *userData ) { rtapi_->setErrorCallback(errorCallback, userData); }
 inline void RtMidiIn :: setBufferSize( unsigned int size, unsigned int count ) { static_cast<MidiInApi *>(rtapi_)->setBufferSize(size, count); }
 
@@ -672,8 +1342,17 @@ inline void RtMidiOut :: closePort( void ) { rtapi_->closePort(); }
 inline bool RtMidiOut :: isPortOpen() const { return rtapi_->isPortOpen(); }
 inline unsigned int RtMidiOut :: getPortCount( void ) { return rtapi_->getPortCount(); }
 inline std::string RtMidiOut :: getPortName( unsigned int portNumber ) { return rtapi_->getPortName( portNumber ); }
-inline void RtMidiOut :: sendMessage( const std::vector<unsigned char> *message ) { static_cast<MidiOutApi *>(rtapi_)->sendMessage( &message->at(0), message->size() ); }
+inline void RtMidiOut :: sendMessage( const std::vector<unsigned char> *message ) { static_cast<MidiOutApi *>(rtapi_)->sendMessage( message->data(), message->size() ); }
 inline void RtMidiOut :: sendMessage( const unsigned char *message, size_t size ) { static_cast<MidiOutApi *>(rtapi_)->sendMessage( message, size ); }
+inline bool RtMidiOut :: trySendMessage( const unsigned char *message, size_t size ) { return static_cast<MidiOutApi *>(rtapi_)->trySendMessage( message, size ); }
+inline bool RtMidiOut :: trySendMessage( const std::vector<unsigned char> *message ) { return static_cast<MidiOutApi *>(rtapi_)->trySendMessage( message->data(), message->size() ); }
+inline void RtMidiOut :: sendMessageAt( int64_t monotonicTime, const unsigned char *message, size_t size ) { static_cast<MidiOutApi *>(rtapi_)->sendMessageAt( monotonicTime, message, size ); }
+inline void RtMidiOut :: sendMessageAt( int64_t monotonicTime, const std::vector<unsigned char> *message ) { static_cast<MidiOutApi *>(rtapi_)->sendMessageAt( monotonicTime, message->data(), message->size() ); }
+inline void RtMidiOut :: sendMessageAt( RtMidiIn::TimePoint time, const unsigned char *message, size_t size ) { static_cast<MidiOutApi *>(rtapi_)->sendMessageAt( time.time_since_epoch().count(), message, size ); }
+inline void RtMidiOut :: sendMessageAt( RtMidiIn::TimePoint time, const std::vector<unsigned char> *message ) { static_cast<MidiOutApi *>(rtapi_)->sendMessageAt( time.time_since_epoch().count(), message->data(), message->size() ); }
+inline void RtMidiOut :: sendMessages( const unsigned char *bytes, const size_t *offsets, size_t count ) { static_cast<MidiOutApi *>(rtapi_)->sendMessages( bytes, offsets, count ); }
+inline void RtMidiOut :: setFlushPolicy( FlushPolicy policy, double maxLatency ) { static_cast<MidiOutApi *>(rtapi_)->setFlushPolicy( policy, maxLatency ); }
+inline void RtMidiOut :: flush( void ) { static_cast<MidiOutApi *>(rtapi_)->flush(); }
 inline void RtMidiOut :: setErrorCallback( RtMidiErrorCallback errorCallback, void *userData ) { rtapi_->setErrorCallback(errorCallback, userData); }
 
 } // namespace midi
@@ -37,6 +37,41 @@ class StaticEnumAssertions { StaticEnumAssertions() {
     ENUM_EQUAL( RTMIDI_ERROR_DRIVER_ERROR,       RtMidiError::DRIVER_ERROR );
     ENUM_EQUAL( RTMIDI_ERROR_SYSTEM_ERROR,       RtMidiError::SYSTEM_ERROR );
     ENUM_EQUAL( RTMIDI_ERROR_THREAD_ERROR,       RtMidiError::THREAD_ERROR );
+
+    ENUM_EQUAL( RTMIDI_QUEUE_DROP_NEWEST,  RtMidiIn::QUEUE_DROP_NEWEST );
+    ENUM_EQUAL( RTMIDI_QUEUE_DROP_OLDEST,  RtMidiIn::QUEUE_DROP_OLDEST );
+    ENUM_EQUAL( RTMIDI_QUEUE_GROW,         RtMidiIn::QUEUE_GROW );
+
+    ENUM_EQUAL( RTMIDI_THREAD_DEFAULT,  RtMidiIn::THREAD_DEFAULT );
+    ENUM_EQUAL( RTMIDI_THREAD_FIFO,     RtMidiIn::THREAD_FIFO );
+    ENUM_EQUAL( RTMIDI_THREAD_RR,       RtMidiIn::THREAD_RR );
+
+    ENUM_EQUAL( RTMIDI_PORT_ADDED,    RtMidi::PORT_ADDED );
+    ENUM_EQUAL( RTMIDI_PORT_REMOVED,  RtMidi::PORT_REMOVED );
+
+    ENUM_EQUAL( RTMIDI_FLUSH_IMMEDIATE,  RtMidiOut::FLUSH_IMMEDIATE );
+    ENUM_EQUAL( RTMIDI_FLUSH_BATCH,      RtMidiOut::FLUSH_BATCH );
+    ENUM_EQUAL( RTMIDI_FLUSH_DEFERRED,   RtMidiOut::FLUSH_DEFERRED );
+
+    ENUM_EQUAL( RTMIDI_TYPE_NOTE_OFF,         RtMidiIn::TYPE_NOTE_OFF );
+    ENUM_EQUAL( RTMIDI_TYPE_NOTE_ON,          RtMidiIn::TYPE_NOTE_ON );
+    ENUM_EQUAL( RTMIDI_TYPE_KEY_PRESSURE,     RtMidiIn::TYPE_KEY_PRESSURE );
+    ENUM_EQUAL( RTMIDI_TYPE_CONTROL_CHANGE,   RtMidiIn::TYPE_CONTROL_CHANGE );
+    ENUM_EQUAL( RTMIDI_TYPE_PROGRAM_CHANGE,   RtMidiIn::TYPE_PROGRAM_CHANGE );
+    ENUM_EQUAL( RTMIDI_TYPE_CHANNEL_PRESSURE, RtMidiIn::TYPE_CHANNEL_PRESSURE );
+    ENUM_EQUAL( RTMIDI_TYPE_PITCH_BEND,       RtMidiIn::TYPE_PITCH_BEND );
+    ENUM_EQUAL( RTMIDI_TYPE_SYSEX,            RtMidiIn::TYPE_SYSEX );
+    ENUM_EQUAL( RTMIDI_TYPE_TIME_CODE,        RtMidiIn::TYPE_TIME_CODE );
+    ENUM_EQUAL( RTMIDI_TYPE_SONG_POSITION,    RtMidiIn::TYPE_SONG_POSITION );
+    ENUM_EQUAL( RTMIDI_TYPE_SONG_SELECT,      RtMidiIn::TYPE_SONG_SELECT );
+    ENUM_EQUAL( RTMIDI_TYPE_TUNE_REQUEST,     RtMidiIn::TYPE_TUNE_REQUEST );
+    ENUM_EQUAL( RTMIDI_TYPE_CLOCK,            RtMidiIn::TYPE_CLOCK );
+    ENUM_EQUAL( RTMIDI_TYPE_TICK,             RtMidiIn::TYPE_TICK );
+    ENUM_EQUAL( RTMIDI_TYPE_START,            RtMidiIn::TYPE_START );
+    ENUM_EQUAL( RTMIDI_TYPE_CONTINUE,         RtMidiIn::TYPE_CONTINUE );
+    ENUM_EQUAL( RTMIDI_TYPE_STOP,             RtMidiIn::TYPE_STOP );
+    ENUM_EQUAL( RTMIDI_TYPE_ACTIVE_SENSING,   RtMidiIn::TYPE_ACTIVE_SENSING );
+    ENUM_EQUAL( RTMIDI_TYPE_SYSTEM_RESET,     RtMidiIn::TYPE_SYSTEM_RESET );
 }};
 
 template <typename T>
@@ -96,6 +131,11 @@ enum RtMidiApi rtmidi_compiled_api_by_name(const char *name) {
     return (enum RtMidiApi)api;
 }
 
+void rtmidi_set_shared_client(bool shared)
+{
+    RtMidi::setSharedClient(shared);
+}
+
 void rtmidi_open_port (RtMidiPtr device, unsigned int portNumber, const char *portName)
 {
     std::string name = portName;
@@ -167,6 +207,37 @@ int rtmidi_get_port_name (RtMidiPtr device, unsigned int portNumber, char * bufO
     return snprintf(bufOut, static_cast<size_t>(*bufLen), "%s", name.c_str());
 }
 
+void rtmidi_set_system_buffer_size (RtMidiPtr device, unsigned int bufferSize, unsigned int poolSize)
+{
+    try {
+        ((RtMidi*) device->ptr)->setSystemBufferSize (bufferSize, poolSize);
+
+    } catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+    }
+}
+
+unsigned long rtmidi_get_overrun_count (RtMidiPtr device)
+{
+    return ((RtMidi*) device->ptr)->getOverrunCount ();
+}
+
+unsigned long rtmidi_get_lost_event_count (RtMidiPtr device)
+{
+    return ((RtMidi*) device->ptr)->getLostEventCount ();
+}
+
+unsigned int rtmidi_get_system_buffer_fill (RtMidiPtr device)
+{
+    return ((RtMidi*) device->ptr)->getSystemBufferFill ();
+}
+
+unsigned int rtmidi_get_system_buffer_peak (RtMidiPtr device)
+{
+    return ((RtMidi*) device->ptr)->getSystemBufferPeak ();
+}
+
 /* RtMidiIn API */
 RtMidiInPtr rtmidi_in_create_default ()
 {
@@ -193,12 +264,22 @@ RtMidiInPtr rtmidi_in_create_default ()
 }
 
 RtMidiInPtr rtmidi_in_create (enum RtMidiApi api, const char *clientName, unsigned int queueSizeLimit)
+{
+    return rtmidi_in_create_with_overflow_policy (api, clientName, queueSizeLimit,
+                                                  RTMIDI_QUEUE_DROP_NEWEST, 0);
+}
+
+RtMidiInPtr rtmidi_in_create_with_overflow_policy (enum RtMidiApi api, const char *clientName,
+                                                   unsigned int queueSizeLimit,
+                                                   enum RtMidiQueueOverflowPolicy overflowPolicy,
+                                                   unsigned int queueSizeCap)
 {
     std::string name = clientName;
     RtMidiWrapper* wrp = new RtMidiWrapper{};
 
     try {
-        RtMidiIn* rIn = new RtMidiIn ((RtMidi::Api) api, name, queueSizeLimit);
+        RtMidiIn* rIn = new RtMidiIn ((RtMidi::Api) api, name, queueSizeLimit,
+                                      (RtMidiIn::QueueOverflowPolicy) overflowPolicy, queueSizeCap);
 
         wrp->ptr = (void*) rIn;
         wrp->callback_proxy = 0;
@@ -226,6 +307,8 @@ void rtmidi_in_free (RtMidiInPtr device)
     if (device->error_callback_proxy)
       delete (CallbackProxyUserData<RtMidiErrorCCallback>*) device->error_callback_proxy;
     delete (RtMidiIn*) device->ptr;
+    if (device->port_callback_proxy)
+      delete (CallbackProxyUserData<RtMidiPortCCallback>*) device->port_callback_proxy;
     delete device;
 }
 
@@ -243,10 +326,28 @@ enum RtMidiApi rtmidi_in_get_current_api (RtMidiPtr device)
 }
 
 static
-void callback_proxy (double timeStamp, std::vector<unsigned char> *message, void *userData)
+void callback_proxy (double timeStamp, const unsigned char *message, size_t size, void *userData)
 {
   CallbackProxyUserData<RtMidiCCallback>* proxy = reinterpret_cast<CallbackProxyUserData<RtMidiCCallback>*> (userData);
-  proxy->c_callback (timeStamp, message->data (), message->size (), proxy->user_data);
+  proxy->c_callback (timeStamp, message, size, proxy->user_data);
+}
+
+// The C info callback is stored as a RtMidiCCallback so that the
+// proxy is released the same way as for rtmidi_in_set_callback().
+// Casting through a generic function pointer keeps compilers quiet.
+typedef void (*GenericCallback) (void);
+
+static
+void info_callback_proxy (const RtMidiIn::MessageInfo &info, const unsigned char *message, size_t size, void *userData)
+{
+  CallbackProxyUserData<RtMidiCCallback>* proxy = reinterpret_cast<CallbackProxyUserData<RtMidiCCallback>*> (userData);
+  RtMidiMessageInfo cInfo;
+  cInfo.timeStamp = info.timeStamp;
+  cInfo.monotonicTime = info.monotonicTime;
+  cInfo.frameTime = info.frameTime;
+  cInfo.apiTime = info.apiTime;
+  cInfo.deltaTime = info.delta.count();
+  reinterpret_cast<RtMidiCInfoCallback> (reinterpret_cast<GenericCallback> (proxy->c_callback)) (&cInfo, message, size, proxy->user_data);
 }
 
 static
@@ -269,6 +370,19 @@ void rtmidi_in_set_callback (RtMidiInPtr device, RtMidiCCallback callback, void
     }
 }
 
+void rtmidi_in_set_info_callback (RtMidiInPtr device, RtMidiCInfoCallback callback, void *userData)
+{
+    device->callback_proxy = (void*) new CallbackProxyUserData<RtMidiCCallback> (reinterpret_cast<RtMidiCCallback> (reinterpret_cast<GenericCallback> (callback)), userData);
+    try {
+        ((RtMidiIn*) device->ptr)->setCallback (info_callback_proxy, device->callback_proxy);
+    } catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+        delete (CallbackProxyUserData<RtMidiCCallback>*) device->callback_proxy;
+        device->callback_proxy = 0;
+    }
+}
+
 void rtmidi_in_cancel_callback (RtMidiInPtr device)
 {
     try {
@@ -294,11 +408,45 @@ void rtmidi_set_error_callback (RtMidiOutPtr device, RtMidiErrorCCallback callba
     }
 }
 
+static
+void port_callback_proxy (RtMidi::PortChange change, const std::string &portName, void *userData)
+{
+  CallbackProxyUserData<RtMidiPortCCallback>* proxy = reinterpret_cast<CallbackProxyUserData<RtMidiPortCCallback>*> (userData);
+  proxy->c_callback (static_cast<RtMidiPortChange>(change), portName.c_str (), proxy->user_data);
+}
+
+void rtmidi_set_port_callback (RtMidiPtr device, RtMidiPortCCallback callback, void *userData)
+{
+    // The previous proxy is no longer in use once the callback is replaced.
+    void *previous = device->port_callback_proxy;
+    device->port_callback_proxy = callback ? (void*) new CallbackProxyUserData<RtMidiPortCCallback> (callback, userData) : 0;
+    try {
+        if (callback)
+            ((RtMidi*) device->ptr)->setPortCallback (port_callback_proxy, device->port_callback_proxy);
+        else
+            ((RtMidi*) device->ptr)->setPortCallback (NULL, 0);
+    } catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+    }
+    delete (CallbackProxyUserData<RtMidiPortCCallback>*) previous;
+}
+
 void rtmidi_in_ignore_types (RtMidiInPtr device, bool midiSysex, bool midiTime, bool midiSense)
 {
   ((RtMidiIn*) device->ptr)->ignoreTypes (midiSysex, midiTime, midiSense);
 }
 
+void rtmidi_in_ignore_message_types (RtMidiInPtr device, unsigned int types)
+{
+  ((RtMidiIn*) device->ptr)->ignoreMessageTypes (types);
+}
+
+unsigned int rtmidi_in_get_ignored_message_types (RtMidiInPtr device)
+{
+  return ((RtMidiIn*) device->ptr)->getIgnoredMessageTypes ();
+}
+
 double rtmidi_in_get_message (RtMidiInPtr device,
                               unsigned char *message,
                               size_t *size)
@@ -327,6 +475,141 @@ double rtmidi_in_get_message (RtMidiInPtr device,
     }
 }
 
+double rtmidi_in_get_message_info (RtMidiInPtr device,
+                                   unsigned char *message,
+                                   size_t *size,
+                                   struct RtMidiMessageInfo *info)
+{
+    try {
+        std::vector<unsigned char> v;
+        RtMidiIn::MessageInfo i;
+        double ret = ((RtMidiIn*) device->ptr)->getMessage (&v, &i);
+
+        if (v.size () > 0 && v.size() <= *size) {
+            memcpy (message, v.data (), (int) v.size ());
+            info->timeStamp = i.timeStamp;
+            info->monotonicTime = i.monotonicTime;
+            info->frameTime = i.frameTime;
+            info->apiTime = i.apiTime;
+            info->deltaTime = i.delta.count();
+        }
+
+        *size = v.size();
+        return ret;
+    }
+    catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+        return -1;
+    }
+    catch (...) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, "Unknown error");
+        return -1;
+    }
+}
+
+size_t rtmidi_in_get_messages (RtMidiInPtr device,
+                               unsigned char *bytes,
+                               size_t bytesSize,
+                               size_t *offsets,
+                               double *timeStamps,
+                               size_t maxMessages,
+                               int64_t *monotonicTimes)
+{
+    try {
+        return ((RtMidiIn*) device->ptr)->getMessages (bytes, bytesSize, offsets, timeStamps, maxMessages, monotonicTimes);
+    }
+    catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+        return 0;
+    }
+    catch (...) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, "Unknown error");
+        return 0;
+    }
+}
+
+int64_t rtmidi_get_monotonic_time (void)
+{
+    return RtMidiIn::getMonotonicTime ();
+}
+
+bool rtmidi_in_wait_for_message (RtMidiInPtr device, double timeout)
+{
+    try {
+        return ((RtMidiIn*) device->ptr)->waitForMessage (timeout);
+    }
+    catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+        return false;
+    }
+    catch (...) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, "Unknown error");
+        return false;
+    }
+}
+
+int rtmidi_in_get_poll_descriptor (RtMidiInPtr device)
+{
+    return ((RtMidiIn*) device->ptr)->getPollDescriptor ();
+}
+
+unsigned long rtmidi_in_get_dropped_message_count (RtMidiInPtr device)
+{
+    return ((RtMidiIn*) device->ptr)->getDroppedMessageCount ();
+}
+
+unsigned int rtmidi_in_get_queue_high_water_mark (RtMidiInPtr device)
+{
+    return ((RtMidiIn*) device->ptr)->getQueueHighWaterMark ();
+}
+
+void rtmidi_in_set_thread_scheduling (RtMidiInPtr device, enum RtMidiThreadScheduling scheduling, int priority)
+{
+    try {
+        ((RtMidiIn*) device->ptr)->setThreadScheduling ((RtMidiIn::ThreadScheduling) scheduling, priority);
+    } catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+    }
+}
+
+void rtmidi_in_set_thread_affinity (RtMidiInPtr device, const unsigned int *cpus, size_t count)
+{
+    try {
+        std::vector<unsigned int> v (cpus, cpus + count);
+        ((RtMidiIn*) device->ptr)->setThreadAffinity (v);
+    } catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+    }
+}
+
+void rtmidi_in_set_thread_name (RtMidiInPtr device, const char *name)
+{
+    try {
+        ((RtMidiIn*) device->ptr)->setThreadName (name);
+    } catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+    }
+}
+
+void rtmidi_in_set_realtime_delivery (RtMidiInPtr device, bool realtime)
+{
+    try {
+        ((RtMidiIn*) device->ptr)->setRealtimeDelivery (realtime);
+    } catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+    }
+}
+
 /* RtMidiOut API */
 RtMidiOutPtr rtmidi_out_create_default ()
 {
@@ -383,6 +666,8 @@ void rtmidi_out_free (RtMidiOutPtr device)
     if (device->msg)
       free (device->msg);
     delete (RtMidiOut*) device->ptr;
+    if (device->port_callback_proxy)
+      delete (CallbackProxyUserData<RtMidiPortCCallback>*) device->port_callback_proxy;
     delete device;
 }
 
@@ -417,6 +702,81 @@ int rtmidi_out_send_message (RtMidiOutPtr device, const unsigned char *message,
     }
 }
 
+int rtmidi_out_try_send_message (RtMidiOutPtr device, const unsigned char *message, int length)
+{
+    try {
+        return ((RtMidiOut*) device->ptr)->trySendMessage (message, length) ? 0 : 1;
+    }
+    catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+        return -1;
+    }
+    catch (...) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, "Unknown error");
+        return -1;
+    }
+}
+
+int rtmidi_out_send_message_at (RtMidiOutPtr device, int64_t monotonicTime, const unsigned char *message, int length)
+{
+    try {
+        ((RtMidiOut*) device->ptr)->sendMessageAt (monotonicTime, message, length);
+        return 0;
+    }
+    catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+        return -1;
+    }
+    catch (...) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, "Unknown error");
+        return -1;
+    }
+}
+
+int rtmidi_out_send_messages (RtMidiOutPtr device, const unsigned char *bytes, const size_t *offsets, size_t count)
+{
+    try {
+        ((RtMidiOut*) device->ptr)->sendMessages (bytes, offsets, count);
+        return 0;
+    }
+    catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+        return -1;
+    }
+    catch (...) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, "Unknown error");
+        return -1;
+    }
+}
+
+void rtmidi_out_set_flush_policy (RtMidiOutPtr device, enum RtMidiFlushPolicy policy, double maxLatency)
+{
+    try {
+        ((RtMidiOut*) device->ptr)->setFlushPolicy ((RtMidiOut::FlushPolicy) policy, maxLatency);
+
+    } catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+    }
+}
+
+void rtmidi_out_flush (RtMidiOutPtr device)
+{
+    try {
+        ((RtMidiOut*) device->ptr)->flush ();
+
+    } catch (const RtMidiError & err) {
+        device->ok  = false;
+        rtmidi_set_error_msg (device, err.what ());
+    }
+}
+
 static void rtmidi_set_error_msg (RtMidiPtr device, const char *err)
 {
     if (device->msg) {
@@ -18,6 +18,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #ifndef RTMIDI_C_H
 #define RTMIDI_C_H
 
@@ -47,6 +48,8 @@ struct RtMidiWrapper {
 
     //! If an error occurred (ok != true), set to an error message.
     char* msg;
+
+    void* port_callback_proxy;
 };
 
 //! \brief Typedef for a generic RtMidi pointer.
@@ -87,6 +90,56 @@ enum RtMidiErrorType {
   RTMIDI_ERROR_THREAD_ERROR       /*!< A thread error occurred. */
 };
 
+//! \brief Input queue overflow policies.  See \ref RtMidiIn::QueueOverflowPolicy.
+enum RtMidiQueueOverflowPolicy {
+  RTMIDI_QUEUE_DROP_NEWEST,  /*!< Discard the incoming message (default). */
+  RTMIDI_QUEUE_DROP_OLDEST,  /*!< Discard the oldest queued message to make room. */
+  RTMIDI_QUEUE_GROW          /*!< Enlarge the queue up to a size cap, then discard incoming messages. */
+};
+
+//! \brief Input thread scheduling policies.  See \ref RtMidiIn::ThreadScheduling.
+enum RtMidiThreadScheduling {
+  RTMIDI_THREAD_DEFAULT,  /*!< Time-sharing scheduling (SCHED_OTHER, default). */
+  RTMIDI_THREAD_FIFO,     /*!< Real-time first-in, first-out scheduling (SCHED_FIFO). */
+  RTMIDI_THREAD_RR        /*!< Real-time round-robin scheduling (SCHED_RR). */
+};
+
+//! \brief When sent messages are written out.  See \ref RtMidiOut::FlushPolicy.
+enum RtMidiFlushPolicy {
+  RTMIDI_FLUSH_IMMEDIATE,  /*!< Write out each message as soon as it is sent. */
+  RTMIDI_FLUSH_BATCH,      /*!< Write out the messages of each send call at once (default). */
+  RTMIDI_FLUSH_DEFERRED    /*!< Hold messages back for up to a maximum latency, or until flushed. */
+};
+
+//! \brief How a port changed.  See \ref RtMidi::PortChange.
+enum RtMidiPortChange {
+  RTMIDI_PORT_ADDED,    /*!< The port appeared. */
+  RTMIDI_PORT_REMOVED   /*!< The port disappeared. */
+};
+
+//! \brief MIDI message types, combined into a set.  See \ref RtMidiIn::MessageType.
+enum RtMidiMessageType {
+  RTMIDI_TYPE_NOTE_OFF         = 0x00001,  /*!< Note off (0x8n). */
+  RTMIDI_TYPE_NOTE_ON          = 0x00002,  /*!< Note on (0x9n). */
+  RTMIDI_TYPE_KEY_PRESSURE     = 0x00004,  /*!< Polyphonic key pressure (0xAn). */
+  RTMIDI_TYPE_CONTROL_CHANGE   = 0x00008,  /*!< Control change (0xBn). */
+  RTMIDI_TYPE_PROGRAM_CHANGE   = 0x00010,  /*!< Program change (0xCn). */
+  RTMIDI_TYPE_CHANNEL_PRESSURE = 0x00020,  /*!< Channel pressure (0xDn). */
+  RTMIDI_TYPE_PITCH_BEND       = 0x00040,  /*!< Pitch bend (0xEn). */
+  RTMIDI_TYPE_SYSEX            = 0x00080,  /*!< System exclusive (0xF0). */
+  RTMIDI_TYPE_TIME_CODE        = 0x00100,  /*!< MIDI time code quarter frame (0xF1). */
+  RTMIDI_TYPE_SONG_POSITION    = 0x00200,  /*!< Song position pointer (0xF2). */
+  RTMIDI_TYPE_SONG_SELECT      = 0x00400,  /*!< Song select (0xF3). */
+  RTMIDI_TYPE_TUNE_REQUEST     = 0x00800,  /*!< Tune request (0xF6). */
+  RTMIDI_TYPE_CLOCK            = 0x01000,  /*!< Timing clock (0xF8). */
+  RTMIDI_TYPE_TICK             = 0x02000,  /*!< Timing tick (0xF9). */
+  RTMIDI_TYPE_START            = 0x04000,  /*!< Start (0xFA). */
+  RTMIDI_TYPE_CONTINUE         = 0x08000,  /*!< Continue (0xFB). */
+  RTMIDI_TYPE_STOP             = 0x10000,  /*!< Stop (0xFC). */
+  RTMIDI_TYPE_ACTIVE_SENSING   = 0x20000,  /*!< Active sensing (0xFE). */
+  RTMIDI_TYPE_SYSTEM_RESET     = 0x40000   /*!< System reset (0xFF). */
+};
+
 /*! \brief The type of a RtMidi callback function.
  *
  * \param timeStamp   The time at which the message has been received.
@@ -98,6 +151,32 @@ enum RtMidiErrorType {
 typedef void(* RtMidiCCallback) (double timeStamp, const unsigned char* message,
                                  size_t messageSize, void *userData);
 
+//! \brief The times at which an incoming MIDI message has been received.
+//! See \ref RtMidiIn::MessageInfo.
+struct RtMidiMessageInfo {
+    //! The delta-time since the previous message, in seconds.
+    double timeStamp;
+    //! The absolute time of the message in nanoseconds, see \ref rtmidi_get_monotonic_time().
+    int64_t monotonicTime;
+    //! The position of the message in the audio stream in frames, or -1 (JACK callbacks only).
+    int64_t frameTime;
+    //! The time of the message in microseconds on the clock of the API, or -1 (JACK callbacks only).
+    int64_t apiTime;
+    //! The delta-time since the previous message, in nanoseconds, from which \e timeStamp is computed.
+    int64_t deltaTime;
+};
+
+/*! \brief The type of a RtMidi callback function receiving absolute timestamps.
+ *
+ * \param info        The delta and absolute times of the message.
+ * \param message     The midi message.
+ * \param userData    Additional user data for the callback.
+ *
+ * See \ref RtMidiIn::RtMidiInfoCallback.
+ */
+typedef void(* RtMidiCInfoCallback) (const struct RtMidiMessageInfo *info, const unsigned char* message,
+                                     size_t messageSize, void *userData);
+
 /*! \brief The type of a RtMidi error callback function.
  *
  * \param type        Type of error
@@ -110,6 +189,18 @@ typedef void(* RtMidiErrorCCallback) (enum RtMidiErrorType type,
                                       const char *errorText,
                                       void *userData);
 
+/*! \brief The type of a RtMidi port callback function.
+ *
+ * \param change      Whether the port appeared or disappeared
+ * \param portName    The name of the port, see \ref rtmidi_get_port_name()
+ * \param userData    Additional user data for the callback.
+ *
+ * See \ref RtMidi::RtMidiPortCallback.
+ */
+typedef void(* RtMidiPortCCallback) (enum RtMidiPortChange change,
+                                     const char *portName,
+                                     void *userData);
+
 /* RtMidi API */
 
 /*! \brief Return the current RtMidi version.
@@ -144,6 +235,10 @@ RTMIDIAPI const char *rtmidi_api_display_name(enum RtMidiApi api);
 //! See \ref RtMidi::getCompiledApiByName().
 RTMIDIAPI enum RtMidiApi rtmidi_compiled_api_by_name(const char *name);
 
+//! \brief Make devices created from now on share a single client of the MIDI API.
+//! See \ref RtMidi::setSharedClient().
+RTMIDIAPI void rtmidi_set_shared_client(bool shared);
+
 /*! \brief Open a MIDI port.
  *
  * \param port      Must be greater than 0
@@ -181,6 +276,31 @@ RTMIDIAPI unsigned int rtmidi_get_port_count (RtMidiPtr device);
  */
 RTMIDIAPI int rtmidi_get_port_name (RtMidiPtr device, unsigned int portNumber, char * bufOut, int * bufLen);
 
+/*! \brief Set the sizes of the buffers that the MIDI API keeps for the device.
+ * See RtMidi::setSystemBufferSize().
+ */
+RTMIDIAPI void rtmidi_set_system_buffer_size (RtMidiPtr device, unsigned int bufferSize, unsigned int poolSize);
+
+/*! \brief Return the number of times the buffers of the MIDI API overran.
+ * See RtMidi::getOverrunCount().
+ */
+RTMIDIAPI unsigned long rtmidi_get_overrun_count (RtMidiPtr device);
+
+/*! \brief Return the number of events that the MIDI API reports as lost.
+ * See RtMidi::getLostEventCount().
+ */
+RTMIDIAPI unsigned long rtmidi_get_lost_event_count (RtMidiPtr device);
+
+/*! \brief Return the number of bytes held in the buffer between the application and the MIDI API.
+ * See RtMidi::getSystemBufferFill().
+ */
+RTMIDIAPI unsigned int rtmidi_get_system_buffer_fill (RtMidiPtr device);
+
+/*! \brief Return the largest number of bytes held in that buffer at once.
+ * See RtMidi::getSystemBufferPeak().
+ */
+RTMIDIAPI unsigned int rtmidi_get_system_buffer_peak (RtMidiPtr device);
+
 /* RtMidiIn API */
 
 //! \brief Create a default RtMidiInPtr value, with no initialization.
@@ -199,6 +319,20 @@ RTMIDIAPI RtMidiInPtr rtmidi_in_create_default (void);
  */
 RTMIDIAPI RtMidiInPtr rtmidi_in_create (enum RtMidiApi api, const char *clientName, unsigned int queueSizeLimit);
 
+/*! \brief Create a RtMidiInPtr value, with given api, clientName, queueSizeLimit
+ *         and input queue overflow policy.
+ *
+ *  \param overflowPolicy What to do with incoming messages when the queue is full.
+ *  \param queueSizeCap   With RTMIDI_QUEUE_GROW, the size the queue may grow to
+ *                        (16 times \ref queueSizeLimit if zero).
+ *
+ * See RtMidiIn::RtMidiIn().
+ */
+RTMIDIAPI RtMidiInPtr rtmidi_in_create_with_overflow_policy (enum RtMidiApi api, const char *clientName,
+                                                             unsigned int queueSizeLimit,
+                                                             enum RtMidiQueueOverflowPolicy overflowPolicy,
+                                                             unsigned int queueSizeCap);
+
 //! \brief Free the given RtMidiInPtr.
 RTMIDIAPI void rtmidi_in_free (RtMidiInPtr device);
 
@@ -210,6 +344,10 @@ RTMIDIAPI enum RtMidiApi rtmidi_in_get_current_api (RtMidiPtr device);
 //! See \ref RtMidiIn::setCallback().
 RTMIDIAPI void rtmidi_in_set_callback (RtMidiInPtr device, RtMidiCCallback callback, void *userData);
 
+//! \brief Set a callback function receiving the absolute time of each incoming MIDI message.
+//! See \ref RtMidiIn::setCallback().
+RTMIDIAPI void rtmidi_in_set_info_callback (RtMidiInPtr device, RtMidiCInfoCallback callback, void *userData);
+
 //! \brief Cancel use of the current callback function (if one exists).
 //! See \ref RtMidiIn::cancelCallback().
 RTMIDIAPI void rtmidi_in_cancel_callback (RtMidiInPtr device);
@@ -218,6 +356,14 @@ RTMIDIAPI void rtmidi_in_cancel_callback (RtMidiInPtr device);
 //! See \ref RtMidiIn::ignoreTypes().
 RTMIDIAPI void rtmidi_in_ignore_types (RtMidiInPtr device, bool midiSysex, bool midiTime, bool midiSense);
 
+//! \brief Specify the set of \ref RtMidiMessageType values to ignore during input.
+//! See \ref RtMidiIn::ignoreMessageTypes().
+RTMIDIAPI void rtmidi_in_ignore_message_types (RtMidiInPtr device, unsigned int types);
+
+//! \brief Returns the set of \ref RtMidiMessageType values ignored during input.
+//! See \ref RtMidiIn::getIgnoredMessageTypes().
+RTMIDIAPI unsigned int rtmidi_in_get_ignored_message_types (RtMidiInPtr device);
+
 /*! Fill the user-provided array with the data bytes for the next available
  * MIDI message in the input queue and return the event delta-time in seconds.
  *
@@ -232,6 +378,66 @@ RTMIDIAPI void rtmidi_in_ignore_types (RtMidiInPtr device, bool midiSysex, bool
  */
 RTMIDIAPI double rtmidi_in_get_message (RtMidiInPtr device, unsigned char *message, size_t *size);
 
+//! \brief Like \ref rtmidi_in_get_message(), also returning the absolute time of the message in \ref info.
+//! See RtMidiIn::getMessage().
+RTMIDIAPI double rtmidi_in_get_message_info (RtMidiInPtr device, unsigned char *message, size_t *size,
+                                             struct RtMidiMessageInfo *info);
+
+/*! Move as many queued MIDI messages as fit into the user-provided
+ * arrays and return the number of messages retrieved.
+ *
+ * \param bytes       Receives the data bytes of all messages, back to back.
+ * \param bytesSize   The size of \ref bytes.
+ * \param offsets     Must hold \ref maxMessages + 1 entries.  Message i
+ *                    spans bytes[offsets[i]] to bytes[offsets[i+1]].
+ * \param timeStamps  Receives the delta-time of each message, or NULL.
+ * \param maxMessages The maximum number of messages to retrieve.
+ * \param monotonicTimes Receives the absolute time of each message in
+ *                    nanoseconds, or NULL.
+ *
+ * See RtMidiIn::getMessages().
+ */
+RTMIDIAPI size_t rtmidi_in_get_messages (RtMidiInPtr device, unsigned char *bytes, size_t bytesSize,
+                                         size_t *offsets, double *timeStamps, size_t maxMessages,
+                                         int64_t *monotonicTimes);
+
+//! \brief Returns the current time in nanoseconds on the timebase of RtMidiMessageInfo::monotonicTime.
+//! See \ref RtMidiIn::getMonotonicTime().
+RTMIDIAPI int64_t rtmidi_get_monotonic_time (void);
+
+//! \brief Wait until a MIDI message is queued or \ref timeout seconds have elapsed.
+//! Returns true if a message is available.
+//! See \ref RtMidiIn::waitForMessage().
+RTMIDIAPI bool rtmidi_in_wait_for_message (RtMidiInPtr device, double timeout);
+
+//! \brief Returns a file descriptor that becomes readable when MIDI messages are queued, or -1.
+//! See \ref RtMidiIn::getPollDescriptor().
+RTMIDIAPI int rtmidi_in_get_poll_descriptor (RtMidiInPtr device);
+
+//! \brief Returns the number of incoming messages discarded because the input queue was full.
+//! See \ref RtMidiIn::getDroppedMessageCount().
+RTMIDIAPI unsigned long rtmidi_in_get_dropped_message_count (RtMidiInPtr device);
+
+//! \brief Returns the largest number of messages held in the input queue at once.
+//! See \ref RtMidiIn::getQueueHighWaterMark().
+RTMIDIAPI unsigned int rtmidi_in_get_queue_high_water_mark (RtMidiInPtr device);
+
+//! \brief Set the scheduling policy and priority of the thread reading MIDI input.
+//! See \ref RtMidiIn::setThreadScheduling().
+RTMIDIAPI void rtmidi_in_set_thread_scheduling (RtMidiInPtr device, enum RtMidiThreadScheduling scheduling, int priority);
+
+//! \brief Restrict the thread reading MIDI input to \ref count CPUs listed in \ref cpus.
+//! See \ref RtMidiIn::setThreadAffinity().
+RTMIDIAPI void rtmidi_in_set_thread_affinity (RtMidiInPtr device, const unsigned int *cpus, size_t count);
+
+//! \brief Set the name of the thread reading MIDI input.
+//! See \ref RtMidiIn::setThreadName().
+RTMIDIAPI void rtmidi_in_set_thread_name (RtMidiInPtr device, const char *name);
+
+//! \brief Deliver MIDI input from the real-time thread of the API.
+//! See \ref RtMidiIn::setRealtimeDelivery().
+RTMIDIAPI void rtmidi_in_set_realtime_delivery (RtMidiInPtr device, bool realtime);
+
 /* RtMidiOut API */
 
 //! \brief Create a default RtMidiInPtr value, with no initialization.
@@ -259,10 +465,46 @@ RTMIDIAPI enum RtMidiApi rtmidi_out_get_current_api (RtMidiPtr device);
 //! See \ref RtMidiOut::sendMessage().
 RTMIDIAPI int rtmidi_out_send_message (RtMidiOutPtr device, const unsigned char *message, int length);
 
+/*! \brief Send a single message if that does not require waiting.
+ *
+ * Returns 0 if the message was sent, 1 if the API would have to wait for
+ * room in its output buffer and nothing was sent, or -1 on error, such as
+ * a message that can never fit in the output buffer.
+ * See \ref RtMidiOut::trySendMessage().
+ */
+RTMIDIAPI int rtmidi_out_try_send_message (RtMidiOutPtr device, const unsigned char *message, int length);
+
+/*! \brief Send a single message at the given time, in nanoseconds on the
+ * timebase of \ref rtmidi_get_monotonic_time().
+ *
+ * See RtMidiOut::sendMessageAt().
+ */
+RTMIDIAPI int rtmidi_out_send_message_at (RtMidiOutPtr device, int64_t monotonicTime, const unsigned char *message, int length);
+
+/*! \brief Send \ref count messages stored back to back in \ref bytes, message i
+ * spanning bytes[offsets[i]] to bytes[offsets[i+1]].
+ *
+ * See RtMidiOut::sendMessages().
+ */
+RTMIDIAPI int rtmidi_out_send_messages (RtMidiOutPtr device, const unsigned char *bytes, const size_t *offsets, size_t count);
+
+//! \brief Set when sent messages are written out to the MIDI API.
+//! See \ref RtMidiOut::setFlushPolicy().
+RTMIDIAPI void rtmidi_out_set_flush_policy (RtMidiOutPtr device, enum RtMidiFlushPolicy policy, double maxLatency);
+
+//! \brief Write out any message held back by the flush policy.
+//! See \ref RtMidiOut::flush().
+RTMIDIAPI void rtmidi_out_flush (RtMidiOutPtr device);
+
 //! \brief Set error callback function on a RtMidiPtr.
 //! See \ref MidiApi::setErrorCallback().
 RTMIDIAPI void rtmidi_set_error_callback (RtMidiPtr device, RtMidiErrorCCallback callback, void *userData);
 
+//! \brief Set a callback function to be invoked when a port appears or disappears,
+//! or remove it with a NULL callback.
+//! See \ref RtMidi::setPortCallback().
+RTMIDIAPI void rtmidi_set_port_callback (RtMidiPtr device, RtMidiPortCCallback callback, void *userData);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,176 @@
+//*****************************************//
+//  alsadecodebench.cpp
+//
+//  Benchmark for the ALSA sequencer event
+//  decoder.  Every event the direct decoder
+//  handles is first checked against
+//  snd_midi_event_decode(), then the CPU
+//  time per event of both is reported for a
+//  typical mix of notes, controllers, clock
+//  and the occasional SysEx, as the best of
+//  several runs.
+//
+//  The decoder is a static function of the
+//  library, so RtMidi.cpp is built into this
+//  program rather than linked.
+//
+//*****************************************//
+
+#include "RtMidi.cpp"
+
+#if defined(__LINUX_ALSA__)
+
+#include <iomanip>
+#include <iostream>
+
+static const unsigned int EVENTS = 1024;
+static const unsigned int ROUNDS = 2000;
+static const unsigned int RUNS = 5;
+
+static bool check( snd_midi_event_t *coder, const snd_seq_event_t &ev )
+{
+  unsigned char expected[512], shortMessage[3];
+  const unsigned char *bytes;
+  long size = alsaDecodeEvent( &ev, shortMessage, &bytes );
+  if ( size < 0 ) return true;
+  long expectedSize = snd_midi_event_decode( coder, expected, sizeof( expected ), &ev );
+  if ( size == expectedSize && std::equal( bytes, bytes + size, expected ) ) return true;
+  std::cout << "Mismatch for event type " << (int) ev.type << ": " << size
+            << " bytes, expected " << expectedSize << "\n";
+  return false;
+}
+
+// Run every event type through both decoders, with every channel and
+// a spread of data values.
+static bool checkAll( snd_midi_event_t *coder )
+{
+  static const int values[] = { 0, 1, 63, 64, 127, 128, 8191, -8192, 16383, -1 };
+  unsigned char sysex[256];
+  for ( int type = 0; type <= SND_SEQ_EVENT_SENSING; type++ ) {
+    for ( int channel = 0; channel < 16; channel++ ) {
+      for ( size_t i = 0; i < sizeof( values ) / sizeof( values[0] ); i++ ) {
+        snd_seq_event_t ev;
+        snd_seq_ev_clear( &ev );
+        ev.type = (snd_seq_event_type_t) type;
+        if ( type >= SND_SEQ_EVENT_NOTE && type <= SND_SEQ_EVENT_KEYPRESS ) {
+          ev.data.note.channel = (unsigned char) channel;
+          ev.data.note.note = (unsigned char) values[i];
+          ev.data.note.velocity = (unsigned char) ( 127 - values[i] );
+        }
+        else {
+          ev.data.control.channel = (unsigned char) channel;
+          ev.data.control.param = (unsigned int) values[i];
+          ev.data.control.value = values[i];
+        }
+        if ( !check( coder, ev ) ) return false;
+      }
+    }
+  }
+  for ( size_t size = 1; size <= sizeof( sysex ); size++ ) {
+    for ( size_t i = 0; i < size; i++ ) sysex[i] = (unsigned char) ( i & 0x7F );
+    sysex[0] = 0xF0;
+    sysex[size - 1] = 0xF7;
+    snd_seq_event_t ev;
+    snd_seq_ev_clear( &ev );
+    snd_seq_ev_set_sysex( &ev, size, sysex );
+    if ( !check( coder, ev ) ) return false;
+  }
+  return true;
+}
+
+// Event i of the mix is a 32 byte SysEx every 256 events, a clock tick
+// every 4 events and a note on, note off, controller or pitch bend
+// otherwise.
+static void fillEvents( std::vector<snd_seq_event_t> &events, unsigned char *sysex )
+{
+  for ( size_t i = 0; i < 32; i++ ) sysex[i] = (unsigned char) i;
+  sysex[0] = 0xF0;
+  sysex[31] = 0xF7;
+  events.resize( EVENTS );
+  for ( unsigned int i = 0; i < EVENTS; i++ ) {
+    snd_seq_event_t &ev = events[i];
+    snd_seq_ev_clear( &ev );
+    unsigned char channel = (unsigned char) ( i & 0x0F );
+    if ( i % 256 == 0 )
+      snd_seq_ev_set_sysex( &ev, 32, sysex );
+    else if ( i % 4 == 0 )
+      ev.type = SND_SEQ_EVENT_CLOCK;
+    else if ( i % 4 == 1 )
+      snd_seq_ev_set_noteon( &ev, channel, i & 0x7F, 100 );
+    else if ( i % 4 == 2 && i % 8 < 4 )
+      snd_seq_ev_set_noteoff( &ev, channel, i & 0x7F, 0 );
+    else if ( i % 4 == 2 )
+      snd_seq_ev_set_controller( &ev, channel, 7, i & 0x7F );
+    else
+      snd_seq_ev_set_pitchbend( &ev, channel, (int) ( i * 16 ) % 16384 - 8192 );
+  }
+}
+
+// Decode the mix ROUNDS times and return the time per event in
+// nanoseconds.  The byte sum keeps the work from being optimized away.
+static double decode( const std::vector<snd_seq_event_t> &events, snd_midi_event_t *coder,
+                      unsigned long *sum )
+{
+  unsigned char buffer[256], shortMessage[3];
+  const unsigned char *bytes;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for ( unsigned int n = 0; n < ROUNDS; n++ ) {
+    for ( unsigned int i = 0; i < EVENTS; i++ ) {
+      long size = coder ? -1 : alsaDecodeEvent( &events[i], shortMessage, &bytes );
+      if ( size < 0 ) {
+        bytes = buffer;
+        size = snd_midi_event_decode( coder, buffer, sizeof( buffer ), &events[i] );
+      }
+      if ( size > 0 ) *sum += bytes[size - 1] + size;
+    }
+  }
+  double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  return seconds * 1e9 / ( (double) EVENTS * ROUNDS );
+}
+
+int main()
+{
+  snd_midi_event_t *coder;
+  if ( snd_midi_event_new( 0, &coder ) < 0 ) {
+    std::cout << "Error initializing the MIDI event parser\n";
+    return 1;
+  }
+  snd_midi_event_init( coder );
+  snd_midi_event_no_status( coder, 1 );
+
+  if ( !checkAll( coder ) ) {
+    snd_midi_event_free( coder );
+    return 1;
+  }
+
+  std::vector<snd_seq_event_t> events;
+  unsigned char sysex[32];
+  fillEvents( events, sysex );
+
+  unsigned long sum = 0;
+  double generic = 1e9, direct = 1e9;
+  for ( unsigned int i = 0; i < RUNS; i++ ) {
+    generic = std::min( generic, decode( events, coder, &sum ) );
+    direct = std::min( direct, decode( events, 0, &sum ) );
+  }
+  snd_midi_event_free( coder );
+
+  std::cout << std::fixed << std::setprecision( 1 );
+  std::cout << "snd_midi_event_decode: " << generic << " ns/event\n";
+  std::cout << "direct decoder:        " << direct << " ns/event\n";
+  std::cout << "(checksum " << sum << ")\n";
+  return 0;
+}
+
+#else
+
+#include <iostream>
+
+int main()
+{
+  std::cout << "The ALSA API is not compiled in, nothing to benchmark.\n";
+  return 0;
+}
+
+#endif
@@ -0,0 +1,211 @@
+//*****************************************//
+//  clockflood.cpp
+//
+//  Test for the filtering of ignored MIDI
+//  message types.  The messages that reach
+//  an input are first checked against the
+//  ignored set.  Then, with ALSA, a virtual
+//  input port is flooded with MIDI clock
+//  and the wakeups of its input thread are
+//  counted, with the clock passing through
+//  and with the clock ignored, which keeps
+//  it out of the sequencer client.
+//
+//*****************************************//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RtMidi.h"
+
+#if defined(__linux__)
+  #include <dirent.h>
+#endif
+
+static const unsigned int CLOCKS = 1000;
+
+// Deliver one message of each type and check that only the ones not in
+// "ignored" are queued.
+static bool filter( unsigned int ignored )
+{
+  static const unsigned char messages[][3] = {
+    { 0x80, 60, 0 }, { 0x91, 60, 100 }, { 0xA2, 60, 10 }, { 0xB3, 7, 100 },
+    { 0xC4, 5, 0 }, { 0xD5, 20, 0 }, { 0xE6, 0, 64 }, { 0xF0, 0x7E, 0xF7 },
+    { 0xF1, 0x10, 0 }, { 0xF2, 0, 8 }, { 0xF3, 1, 0 }, { 0xF6, 0, 0 },
+    { 0xF8, 0, 0 }, { 0xF9, 0, 0 }, { 0xFA, 0, 0 }, { 0xFB, 0, 0 },
+    { 0xFC, 0, 0 }, { 0xFE, 0, 0 }, { 0xFF, 0, 0 }
+  };
+  const size_t count = sizeof( messages ) / sizeof( messages[0] );
+
+  MidiInApi::RtMidiInData data;
+  data.queue.init( 64 );
+  data.ignoredTypes = ignored;
+  for ( size_t i = 0; i < count; i++ )
+    data.deliver( messages[i], 3, RtMidiIn::Duration( 0 ), RtMidiIn::TimePoint() );
+
+  std::vector<unsigned char> message;
+  double stamp;
+  for ( size_t i = 0; i < count; i++ ) {
+    // The message types are listed in the order of their bits.
+    if ( ignored & ( 1u << i ) ) continue;
+    if ( !data.queue.pop( &message, &stamp ) || message[0] != messages[i][0] ) {
+      std::cout << "Message type 0x" << std::hex << (int) messages[i][0] << std::dec
+                << " missing with ignored types 0x" << std::hex << ignored << std::dec << "\n";
+      return false;
+    }
+  }
+  if ( data.queue.pop( &message, &stamp ) ) {
+    std::cout << "Ignored message type 0x" << std::hex << (int) message[0] << std::dec
+              << " queued with ignored types 0x" << std::hex << ignored << std::dec << "\n";
+    return false;
+  }
+  return true;
+}
+
+#if defined(__linux__)
+
+// Return the number of times the thread named "name" went to sleep,
+// or -1 if there is no such thread.
+static long wakeups( const std::string &name )
+{
+  DIR *dir = opendir( "/proc/self/task" );
+  if ( !dir ) return -1;
+  long switches = -1;
+  while ( struct dirent *entry = readdir( dir ) ) {
+    std::string task = std::string( "/proc/self/task/" ) + entry->d_name;
+    std::string comm;
+    std::ifstream( ( task + "/comm" ).c_str() ) >> comm;
+    if ( comm != name ) continue;
+    std::ifstream status( ( task + "/status" ).c_str() );
+    std::string line;
+    while ( std::getline( status, line ) ) {
+      if ( line.compare( 0, 24, "voluntary_ctxt_switches:" ) == 0 )
+        switches = atol( line.c_str() + 24 );
+    }
+  }
+  closedir( dir );
+  return switches;
+}
+
+static unsigned long received = 0;
+
+static void count( double, std::vector<unsigned char> *, void * )
+{
+  received++;
+}
+
+// Send CLOCKS clock messages, spaced enough for each to be read on its
+// own, and report how often the input thread woke up.
+static bool flood( RtMidiIn &in, RtMidiOut &out, bool ignoreClock, long *result )
+{
+  in.ignoreTypes( true, ignoreClock, true );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+  received = 0;
+  long before = wakeups( "clockflood-in" );
+
+  const unsigned char clock = 0xF8;
+  for ( unsigned int i = 0; i < CLOCKS; i++ ) {
+    out.sendMessage( &clock, 1 );
+    std::this_thread::sleep_for( std::chrono::microseconds( 500 ) );
+  }
+  std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+
+  long after = wakeups( "clockflood-in" );
+  *result = after - before;
+  std::cout << ( ignoreClock ? "clock ignored: " : "clock passed:  " ) << received
+            << " messages, " << *result << " wakeups\n";
+  if ( before < 0 || after < 0 ) {
+    std::cout << "Input thread not found\n";
+    return false;
+  }
+  if ( received != ( ignoreClock ? 0 : CLOCKS ) ) {
+    std::cout << "Unexpected number of clock messages received\n";
+    return false;
+  }
+  return true;
+}
+
+static int alsaFlood()
+{
+  std::vector<RtMidi::Api> apis;
+  RtMidi::getCompiledApi( apis );
+  if ( std::find( apis.begin(), apis.end(), RtMidi::LINUX_ALSA ) == apis.end() ) {
+    std::cout << "ALSA not compiled in, skipping the clock flood\n";
+    return 0;
+  }
+
+  try {
+    RtMidiIn in( RtMidi::LINUX_ALSA, "clockflood" );
+    RtMidiOut out( RtMidi::LINUX_ALSA, "clockflood" );
+
+    in.setCallback( &count );
+    in.openVirtualPort( "clockflood in" );
+    in.setThreadName( "clockflood-in" );
+    unsigned int port = out.getPortCount();
+    for ( unsigned int i = 0; i < out.getPortCount(); i++ ) {
+      if ( out.getPortName( i ).find( "clockflood in" ) != std::string::npos ) port = i;
+    }
+    if ( port == out.getPortCount() ) {
+      std::cout << "Virtual input port not found\n";
+      return 1;
+    }
+    out.openPort( port );
+
+    long passed, ignored;
+    if ( !flood( in, out, false, &passed ) ) return 1;
+    if ( !flood( in, out, true, &ignored ) ) return 1;
+    if ( passed > 0 )
+      std::cout << "wakeups reduced by " << 100 - 100 * ignored / passed << "%\n";
+    // Ignored clock messages are filtered out before they reach the
+    // client, so the input thread must wake up far less often.
+    if ( ignored >= passed / 2 ) {
+      std::cout << "Ignoring the clock did not reduce the wakeups\n";
+      return 1;
+    }
+  }
+  catch ( RtMidiError &error ) {
+    std::cout << "No ALSA sequencer, skipping the clock flood: " << error.getMessage() << "\n";
+  }
+  return 0;
+}
+
+#else
+
+static int alsaFlood()
+{
+  return 0;
+}
+
+#endif
+
+int main()
+{
+  if ( !filter( 0 ) ) return 1;
+  if ( !filter( RtMidiIn::TYPE_SYSEX | RtMidiIn::TYPE_TIME_CODE | RtMidiIn::TYPE_CLOCK |
+                RtMidiIn::TYPE_TICK | RtMidiIn::TYPE_ACTIVE_SENSING ) ) return 1;
+  if ( !filter( RtMidiIn::TYPE_CLOCK ) ) return 1;
+  if ( !filter( RtMidiIn::TYPE_NOTE_ON | RtMidiIn::TYPE_NOTE_OFF | RtMidiIn::TYPE_PITCH_BEND |
+                RtMidiIn::TYPE_SYSTEM_RESET ) ) return 1;
+  if ( !filter( 0x7FFFF ) ) return 1;
+
+  // ignoreTypes() maps onto the message types.
+  try {
+    RtMidiIn in;
+    in.ignoreTypes( false, true, false );
+    if ( in.getIgnoredMessageTypes() !=
+         ( RtMidiIn::TYPE_TIME_CODE | RtMidiIn::TYPE_CLOCK | RtMidiIn::TYPE_TICK ) ) {
+      std::cout << "Unexpected ignored types 0x" << std::hex << in.getIgnoredMessageTypes() << "\n";
+      return 1;
+    }
+  }
+  catch ( RtMidiError &error ) {
+    std::cout << "No MIDI input available: " << error.getMessage() << "\n";
+  }
+
+  return alsaFlood();
+}
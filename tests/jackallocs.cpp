@@ -0,0 +1,145 @@
+//*****************************************//
+//  jackallocs.cpp
+//
+//  Test for the JACK input path.  MIDI
+//  notes and SysEx messages are sent to a
+//  JACK input port of the same program,
+//  while every allocation made through
+//  operator new by the input's process
+//  callback is counted.  There must be
+//  none, and every message must arrive.
+//
+//  The process callback is a static
+//  function of the library, so RtMidi.cpp
+//  is built into this program rather than
+//  linked.
+//
+//*****************************************//
+
+#include "RtMidi.cpp"
+
+#if defined(__UNIX_JACK__)
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+static const unsigned int NOTES = 2000;
+static const unsigned int SYSEX = 50;
+static const size_t SYSEX_SIZE = 300;
+
+static thread_local bool inProcess = false;
+static std::atomic<unsigned long> allocations( 0 );
+
+void *operator new( std::size_t size )
+{
+  if ( inProcess ) allocations++;
+  void *p = std::malloc( size ? size : 1 );
+  if ( !p ) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete( void *p ) noexcept
+{
+  std::free( p );
+}
+
+// Gives access to the JACK data of the input.
+class CountedIn : public MidiInJack
+{
+ public:
+  CountedIn() : MidiInJack( "jackallocs", 4096 ) {}
+  JackMidiData *data() { return static_cast<JackMidiData *>( apiData_ ); }
+};
+
+static int countedProcess( jack_nframes_t nframes, void *arg )
+{
+  inProcess = true;
+  int result = jackProcessIn( nframes, arg );
+  inProcess = false;
+  return result;
+}
+
+static std::atomic<unsigned int> notes( 0 ), sysex( 0 );
+
+static void received( double, std::vector<unsigned char> *message, void * )
+{
+  if ( (*message)[0] == 0xF0 && message->size() == SYSEX_SIZE )
+    sysex++;
+  else if ( ( (*message)[0] & 0xF0 ) == 0x90 )
+    notes++;
+}
+
+int main()
+{
+  CountedIn in;
+  JackMidiData *data = in.data();
+  if ( !data->client ) {
+    std::cout << "JACK server not running, skipping the allocation test\n";
+    return 0;
+  }
+
+  jack_deactivate( data->client );
+  jack_set_process_callback( data->client, countedProcess, data );
+  jack_activate( data->client );
+
+  in.ignoreTypes( false, true, true );
+  in.setCallback( &received, 0 );
+  in.openVirtualPort( "jackallocs in" );
+
+  try {
+    RtMidiOut out( RtMidi::UNIX_JACK, "jackallocs" );
+    unsigned int port = out.getPortCount();
+    for ( unsigned int i = 0; i < out.getPortCount(); i++ ) {
+      if ( out.getPortName( i ).find( "jackallocs in" ) != std::string::npos ) port = i;
+    }
+    if ( port == out.getPortCount() ) {
+      std::cout << "Input port not found\n";
+      return 1;
+    }
+    out.openPort( port );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+
+    std::vector<unsigned char> message( SYSEX_SIZE, 0x55 );
+    message[0] = 0xF0;
+    message[SYSEX_SIZE - 1] = 0xF7;
+    unsigned char note[3] = { 0x90, 60, 100 };
+    for ( unsigned int i = 0; i < NOTES; i++ ) {
+      note[1] = (unsigned char) ( i & 0x7F );
+      out.sendMessage( note, 3 );
+      if ( i % ( NOTES / SYSEX ) == 0 ) out.sendMessage( &message );
+      if ( i % 20 == 0 ) std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+  }
+  catch ( RtMidiError &error ) {
+    error.printMessage();
+    return 1;
+  }
+
+  for ( int i = 0; i < 200 && ( notes < NOTES || sysex < SYSEX ); i++ )
+    std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+  in.closePort();
+
+  std::cout << notes << " notes and " << sysex << " SysEx messages received, "
+            << allocations << " allocations in the process callback, "
+            << in.getOverrunCount() << " overruns, ringbuffer peak "
+            << in.getSystemBufferPeak() << " bytes\n";
+  if ( allocations != 0 ) return 1;
+  if ( notes != NOTES || sysex != SYSEX ) {
+    std::cout << "Messages missing\n";
+    return 1;
+  }
+  return 0;
+}
+
+#else
+
+#include <iostream>
+
+int main()
+{
+  std::cout << "The JACK API is not compiled in, skipping the allocation test.\n";
+  return 0;
+}
+
+#endif
@@ -0,0 +1,134 @@
+//*****************************************//
+//  jackportbench.cpp
+//
+//  Benchmark for the enumeration of JACK
+//  ports.  A client registers 500 MIDI
+//  output ports, then the names of all of
+//  them are read the way applications do,
+//  through getPortCount() and getPortName()
+//  in a loop, once with a jack_get_ports()
+//  call per name as RtMidi used to do, and
+//  once through RtMidiIn, which keeps them
+//  cached.  The time per enumeration is
+//  reported as the best of several runs.
+//
+//  The JACK data is internal to the
+//  library, so RtMidi.cpp is built into
+//  this program rather than linked.
+//
+//*****************************************//
+
+#include "RtMidi.cpp"
+
+#if defined(__UNIX_JACK__)
+
+#include <iomanip>
+#include <iostream>
+
+static const unsigned int PORTS = 500;
+static const unsigned int ROUNDS = 10;
+static const unsigned int RUNS = 5;
+
+// Enumerate the MIDI output ports with a jack_get_ports() call for the
+// count and for every name.
+static size_t uncached( jack_client_t *client )
+{
+  size_t sum = 0;
+  unsigned int count = 0;
+  const char **ports = jack_get_ports( client, NULL, JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput );
+  if ( ports == NULL ) return 0;
+  while ( ports[count] != NULL ) count++;
+  jack_free( ports );
+
+  for ( unsigned int i = 0; i < count; i++ ) {
+    ports = jack_get_ports( client, NULL, JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput );
+    if ( ports == NULL ) break;
+    unsigned int j;
+    for ( j = 0; j < i && ports[j]; j++ ) {}
+    if ( ports[j] ) sum += std::string( ports[j] ).size();
+    jack_free( ports );
+  }
+  return sum;
+}
+
+// Enumerate the ports through RtMidiIn.
+static size_t cached( RtMidiIn *in )
+{
+  size_t sum = 0;
+  unsigned int count = in->getPortCount();
+  for ( unsigned int i = 0; i < count; i++ )
+    sum += in->getPortName( i ).size();
+  return sum;
+}
+
+// Return the time per enumeration in microseconds, as the best of RUNS
+// runs of ROUNDS enumerations.  The name lengths are summed to keep the
+// work from being optimized away.
+template <typename Enumerate, typename Source>
+static double best( Enumerate enumerate, Source source, size_t *sum )
+{
+  double result = 1e12;
+  for ( unsigned int run = 0; run < RUNS; run++ ) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for ( unsigned int n = 0; n < ROUNDS; n++ )
+      *sum += enumerate( source );
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    result = std::min( result, seconds * 1e6 / ROUNDS );
+  }
+  return result;
+}
+
+int main()
+{
+  jack_client_t *client = jack_client_open( "jackportbench ports", JackNoStartServer, NULL );
+  if ( !client ) {
+    std::cout << "JACK server not running, nothing to benchmark.\n";
+    return 0;
+  }
+  for ( unsigned int i = 0; i < PORTS; i++ ) {
+    std::string name = "out " + std::to_string( i );
+    if ( !jack_port_register( client, name.c_str(), JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0 ) ) {
+      std::cout << "Error registering port " << name << "\n";
+      jack_client_close( client );
+      return 1;
+    }
+  }
+  jack_activate( client );
+
+  size_t sum = 0;
+  double before = 0.0, after = 0.0;
+  try {
+    RtMidiIn in( RtMidi::UNIX_JACK, "jackportbench" );
+    if ( in.getPortCount() < PORTS ) {
+      std::cout << "Only " << in.getPortCount() << " ports listed\n";
+      jack_client_close( client );
+      return 1;
+    }
+    before = best( uncached, client, &sum );
+    after = best( cached, &in, &sum );
+  }
+  catch ( RtMidiError &error ) {
+    error.printMessage();
+    jack_client_close( client );
+    return 1;
+  }
+  jack_client_close( client );
+
+  std::cout << std::fixed << std::setprecision( 1 );
+  std::cout << "jack_get_ports() per name: " << before << " us per enumeration\n";
+  std::cout << "cached port list:          " << after << " us per enumeration\n";
+  std::cout << "(checksum " << sum << ")\n";
+  return 0;
+}
+
+#else
+
+#include <iostream>
+
+int main()
+{
+  std::cout << "The JACK API is not compiled in, nothing to benchmark.\n";
+  return 0;
+}
+
+#endif
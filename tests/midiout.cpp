@@ -84,6 +84,21 @@ int main( void )
 
   SLEEP( 500 );
 
+  // A chord sent at once: Note On 144, 60/64/67, 90
+  {
+    const unsigned char chord[] = { 144, 60, 90, 144, 64, 90, 144, 67, 90 };
+    const size_t offsets[] = { 0, 3, 6, 9 };
+    midiout->sendMessages( chord, offsets, 3 );
+
+    SLEEP( 500 );
+
+    // And released: Note Off 128, 60/64/67, 40
+    const unsigned char release[] = { 128, 60, 40, 128, 64, 40, 128, 67, 40 };
+    midiout->sendMessages( release, offsets, 3 );
+  }
+
+  SLEEP( 500 );
+
   // Control Change: 176, 7, 40
   message[0] = 176;
   message[1] = 7;
@@ -0,0 +1,82 @@
+//*****************************************//
+//  porthotplug.cpp
+//
+//  Test for the port callback.  With ALSA
+//  and JACK, an output watches for the
+//  ports it can open while a virtual input
+//  port of the same program appears and
+//  disappears, and both changes must be
+//  reported.
+//
+//*****************************************//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RtMidi.h"
+
+static std::atomic<int> added( 0 ), removed( 0 );
+
+static void portChanged( RtMidi::PortChange change, const std::string &portName, void * )
+{
+  if ( portName.find( "porthotplug in" ) == std::string::npos ) return;
+  std::cout << ( change == RtMidi::PORT_ADDED ? "added:   " : "removed: " ) << portName << "\n";
+  if ( change == RtMidi::PORT_ADDED )
+    added++;
+  else
+    removed++;
+}
+
+// Wait up to a second for a counter to reach one.
+static bool waitFor( const std::atomic<int> &counter )
+{
+  for ( int i = 0; i < 100 && counter == 0; i++ )
+    std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+  return counter == 1;
+}
+
+static int hotplug( RtMidi::Api api )
+{
+  std::vector<RtMidi::Api> apis;
+  RtMidi::getCompiledApi( apis );
+  std::string name = RtMidi::getApiDisplayName( api );
+  if ( std::find( apis.begin(), apis.end(), api ) == apis.end() ) {
+    std::cout << name << " not compiled in, skipping the hotplug test\n";
+    return 0;
+  }
+
+  added = 0;
+  removed = 0;
+  try {
+    RtMidiOut out( api, "porthotplug" );
+    out.setPortCallback( &portChanged );
+
+    {
+      RtMidiIn in( api, "porthotplug" );
+      in.openVirtualPort( "porthotplug in" );
+      if ( !waitFor( added ) ) {
+        std::cout << name << ": port addition not reported\n";
+        return 1;
+      }
+    }
+    if ( !waitFor( removed ) ) {
+      std::cout << name << ": port removal not reported\n";
+      return 1;
+    }
+    out.setPortCallback( NULL );
+  }
+  catch ( RtMidiError &error ) {
+    std::cout << "No " << name << " server, skipping the hotplug test: " << error.getMessage() << "\n";
+  }
+  return 0;
+}
+
+int main()
+{
+  if ( hotplug( RtMidi::LINUX_ALSA ) ) return 1;
+  return hotplug( RtMidi::UNIX_JACK );
+}
@@ -12,15 +12,6 @@
 #include <signal.h>
 #include "RtMidi.h"
 
-// Platform-dependent sleep routines.
-#if defined(_WIN32)
-  #include <windows.h>
-  #define SLEEP( milliseconds ) Sleep( (DWORD) milliseconds ) 
-#else // Unix variants
-  #include <unistd.h>
-  #define SLEEP( milliseconds ) usleep( (unsigned long) (milliseconds * 1000.0) )
-#endif
-
 bool done;
 static void finish( int /*ignore*/ ){ done = true; }
 
@@ -80,7 +71,7 @@ int main( int argc, char *argv[] )
   done = false;
   (void) signal(SIGINT, finish);
 
-  // Periodically check input queue.
+  // Check the input queue whenever a message arrives.
   std::cout << "Reading MIDI from API " << midiin->getApiDisplayName(midiin->getCurrentApi()) << ", port " << midiin->getPortName(port) << " ... quit with Ctrl-C.\n";
   while ( !done ) {
     stamp = midiin->getMessage( &message );
@@ -90,8 +81,10 @@ int main( int argc, char *argv[] )
     if ( nBytes > 0 )
       std::cout << "stamp = " << stamp << std::endl;
 
-    // Sleep for 10 milliseconds.
-    SLEEP( 10 );
+    // Wait for the next message, waking up every 100 milliseconds to
+    // check for Ctrl-C.
+    if ( nBytes == 0 )
+      midiin->waitForMessage( 0.1 );
   }
 
   // Clean up
@@ -0,0 +1,291 @@
+//*****************************************//
+//  queuestress.cpp
+//
+//  Stress test for the MidiInApi input queue.
+//  A producer thread pushes a mix of short
+//  messages and SysEx while the main thread
+//  pops them, one by one and then in batches,
+//  spinning or blocking when the queue is
+//  empty, checking order and content and
+//  reporting the achieved throughput.  The
+//  input queue overflow policies are then
+//  checked, including a producer overrunning
+//  a QUEUE_DROP_OLDEST queue, as well as
+//  SysEx too long for the queue's arena.
+//
+//*****************************************//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RtMidi.h"
+
+typedef MidiInApi::MidiQueue MidiQueue;
+
+static const unsigned int QUEUE_SIZE = 1000;  // rounded up to 1024
+static const unsigned int MESSAGES = 2000000;
+
+// Message i is a SysEx every 64 messages and a 1 to 3 byte message
+// otherwise, with its payload derived from i.
+static size_t fillMessage( unsigned int i, unsigned char *bytes )
+{
+  if ( i % 64 == 0 ) {
+    size_t size = 8 + i % 23;
+    bytes[0] = 0xF0;
+    for ( size_t j = 1; j < size - 1; j++ )
+      bytes[j] = (unsigned char) ( ( i + j ) & 0x7F );
+    bytes[size - 1] = 0xF7;
+    return size;
+  }
+  size_t size = 1 + i % 3;
+  bytes[0] = (unsigned char) ( 0x80 | ( i & 0x0F ) );
+  for ( size_t j = 1; j < size; j++ )
+    bytes[j] = (unsigned char) ( ( i >> ( 4 * j ) ) & 0x7F );
+  return size;
+}
+
+static void producer( MidiQueue *queue )
+{
+  unsigned char bytes[32];
+  for ( unsigned int i = 0; i < MESSAGES; i++ ) {
+    size_t size = fillMessage( i, bytes );
+    while ( !queue->push( bytes, size, (double) i, (int64_t) i ) )
+      std::this_thread::yield();
+  }
+}
+
+// Drain MESSAGES messages from the queue, either one by one or in
+// batches, and check them against the generated sequence.  When the
+// queue is empty, either yield or block in MidiQueue::wait().
+static bool drain( MidiQueue *queue, bool batch, bool block )
+{
+  std::vector<unsigned char> message;
+  unsigned char expected[32];
+  unsigned char bytes[4096];
+  size_t offsets[257];
+  double stamps[256];
+  double stamp;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::thread thread( producer, queue );
+
+  unsigned int received = 0;
+  while ( received < MESSAGES ) {
+    size_t count = 1;
+    if ( batch )
+      count = queue->pop( bytes, sizeof( bytes ), offsets, stamps, 256 );
+    else if ( !queue->pop( &message, &stamp ) )
+      count = 0;
+    if ( count == 0 ) {
+      if ( !block )
+        std::this_thread::yield();
+      else if ( !queue->wait( 5.0 ) ) {
+        std::cout << "Timed out waiting for message " << received << "\n";
+        thread.join();
+        return false;
+      }
+      continue;
+    }
+    for ( size_t i = 0; i < count; i++, received++ ) {
+      size_t size = fillMessage( received, expected );
+      const unsigned char *data = batch ? bytes + offsets[i] : message.data();
+      size_t length = batch ? offsets[i + 1] - offsets[i] : message.size();
+      if ( batch ) stamp = stamps[i];
+      if ( stamp != (double) received || length != size ||
+           !std::equal( data, data + length, expected ) ) {
+        std::cout << "Mismatch at message " << received << "\n";
+        thread.join();
+        return false;
+      }
+    }
+  }
+
+  thread.join();
+  double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+  if ( queue->size() != 0 ) {
+    std::cout << "Queue not empty after draining\n";
+    return false;
+  }
+
+  std::string mode = std::string( batch ? "batch" : "single" ) + ( block ? ", wait:" : ":" );
+  std::cout << std::left << std::setw( 15 ) << mode << received << " messages in "
+            << seconds << " s (" << ( received / seconds / 1e6 ) << " Mmsg/s)\n";
+  return true;
+}
+
+// Fill a queue of 1024 messages with "pushed" messages from the
+// current thread and check which ones survive the overflow policy.
+static bool overflow( RtMidiIn::QueueOverflowPolicy policy, unsigned int cap,
+                      unsigned int pushed, unsigned int first, unsigned int kept )
+{
+  MidiQueue queue;
+  queue.init( QUEUE_SIZE, policy, cap );
+
+  unsigned char bytes[32];
+  for ( unsigned int i = 0; i < pushed; i++ ) {
+    size_t size = fillMessage( i, bytes );
+    queue.push( bytes, size, (double) i, (int64_t) i );
+  }
+
+  if ( queue.size() != kept || queue.dropped.load() != pushed - kept ||
+       queue.highWaterMark.load() != kept ) {
+    std::cout << "Policy " << policy << ": " << queue.size() << " kept, "
+              << queue.dropped.load() << " dropped, high-water mark "
+              << queue.highWaterMark.load() << "\n";
+    return false;
+  }
+
+  std::vector<unsigned char> message;
+  double stamp;
+  int64_t monotonicTime;
+  for ( unsigned int i = first; i < first + kept; i++ ) {
+    size_t size = fillMessage( i, bytes );
+    if ( !queue.pop( &message, &stamp, &monotonicTime ) || stamp != (double) i ||
+         monotonicTime != (int64_t) i || message.size() != size ||
+         !std::equal( message.begin(), message.end(), bytes ) ) {
+      std::cout << "Policy " << policy << ": mismatch at message " << i << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+// Push long messages that wrap around the end of the SysEx arena or do
+// not fit in it at all, and check that they come back intact.
+static bool arena()
+{
+  MidiQueue queue;
+  queue.init( 16 );
+
+  std::vector<unsigned char> sysex( 3 * queue.arenaSize / 2 ), message;
+  double stamp;
+  for ( unsigned int i = 0; i < 100; i++ ) {
+    size_t sizes[3] = { 1000 + i * 37 % 2000, queue.arenaSize / 2, sysex.size() };
+    for ( size_t j = 0; j < 3; j++ ) {
+      sysex[0] = 0xF0;
+      for ( size_t k = 1; k < sizes[j] - 1; k++ ) sysex[k] = (unsigned char) ( ( i + j + k ) & 0x7F );
+      sysex[sizes[j] - 1] = 0xF7;
+      queue.push( sysex.data(), sizes[j], (double) j, (int64_t) j );
+    }
+    for ( size_t j = 0; j < 3; j++ ) {
+      bool ok = queue.pop( &message, &stamp ) && message.size() == sizes[j];
+      for ( size_t k = 1; ok && k < sizes[j] - 1; k++ )
+        ok = message[k] == (unsigned char) ( ( i + j + k ) & 0x7F );
+      if ( !ok || stamp != (double) j ) {
+        std::cout << "Arena: mismatch at message " << j << " of round " << i << "\n";
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static std::atomic<bool> lossyProducerDone;
+
+static void lossyProducer( MidiQueue *queue )
+{
+  unsigned char bytes[32];
+  for ( unsigned int i = 0; i < MESSAGES; i++ ) {
+    size_t size = fillMessage( i, bytes );
+    queue->push( bytes, size, (double) i, (int64_t) i );
+  }
+  lossyProducerDone = true;
+}
+
+// Let a producer overrun a small QUEUE_DROP_OLDEST queue and check that
+// every message received is intact, in order, and that nothing is
+// lost without being counted.
+static bool dropOldest( bool batch )
+{
+  MidiQueue queue;
+  queue.init( 16, RtMidiIn::QUEUE_DROP_OLDEST );
+
+  std::vector<unsigned char> message;
+  unsigned char expected[32];
+  unsigned char bytes[4096];
+  size_t offsets[257];
+  double stamps[256];
+  double stamp;
+  long last = -1;
+  unsigned int received = 0;
+  bool ok = true;
+
+  lossyProducerDone = false;
+  std::thread thread( lossyProducer, &queue );
+  while ( ok ) {
+    size_t count = 1;
+    if ( batch )
+      count = queue.pop( bytes, sizeof( bytes ), offsets, stamps, 256 );
+    else if ( !queue.pop( &message, &stamp ) )
+      count = 0;
+    for ( size_t i = 0; i < count; i++ ) {
+      const unsigned char *data = batch ? bytes + offsets[i] : message.data();
+      size_t length = batch ? offsets[i + 1] - offsets[i] : message.size();
+      if ( batch ) stamp = stamps[i];
+      size_t size = fillMessage( (unsigned int) stamp, expected );
+      if ( stamp <= last || length != size || !std::equal( data, data + length, expected ) ) {
+        std::cout << "Drop-oldest mismatch at message " << stamp << "\n";
+        ok = false;
+        break;
+      }
+      last = (long) stamp;
+      received++;
+    }
+    if ( count == 0 && lossyProducerDone && queue.size() == 0 )
+      break;
+  }
+  thread.join();
+
+  if ( ok && received + queue.dropped.load() != MESSAGES ) {
+    std::cout << "Drop-oldest: " << received << " received and " << queue.dropped.load()
+              << " dropped out of " << MESSAGES << "\n";
+    ok = false;
+  }
+  if ( ok )
+    std::cout << "drop oldest" << ( batch ? ", batch: " : ":        " ) << received
+              << " received, " << queue.dropped.load() << " dropped\n";
+  return ok;
+}
+
+int main()
+{
+  MidiQueue queue;
+  queue.init( QUEUE_SIZE );
+  if ( queue.ringSize != 1024 ) {
+    std::cout << "Unexpected queue size " << queue.ringSize << "\n";
+    return 1;
+  }
+
+  if ( !drain( &queue, false, false ) ) return 1;
+  if ( !drain( &queue, true, false ) ) return 1;
+  if ( !drain( &queue, false, true ) ) return 1;
+  if ( !drain( &queue, true, true ) ) return 1;
+
+  // Waiting on an empty queue must time out.
+  if ( queue.wait( 0.01 ) ) {
+    std::cout << "wait() returned true on an empty queue\n";
+    return 1;
+  }
+
+  // Overflow policies.
+  if ( !overflow( RtMidiIn::QUEUE_DROP_NEWEST, 0, 2000, 0, 1024 ) ) return 1;
+  if ( !overflow( RtMidiIn::QUEUE_DROP_OLDEST, 0, 2000, 976, 1024 ) ) return 1;
+  if ( !overflow( RtMidiIn::QUEUE_GROW, 4096, 5000, 0, 4096 ) ) return 1;
+  if ( !arena() ) return 1;
+  if ( !dropOldest( false ) ) return 1;
+  if ( !dropOldest( true ) ) return 1;
+
+  // A growing queue starting small must deliver the full sequence.
+  MidiQueue growing;
+  growing.init( 16, RtMidiIn::QUEUE_GROW, 4096 );
+  if ( !drain( &growing, false, false ) ) return 1;
+  if ( !drain( &growing, true, true ) ) return 1;
+  return 0;
+}
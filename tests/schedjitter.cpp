@@ -0,0 +1,119 @@
+//*****************************************//
+//  schedjitter.cpp
+//
+//  Test for scheduled MIDI output.  With
+//  ALSA and JACK, notes are sent through a
+//  virtual input port of the same program,
+//  once by sleeping until each note is due
+//  and calling sendMessage(), and once by
+//  handing the whole sequence to
+//  sendMessageAt() in advance.  The
+//  arrival times of the notes, stamped by
+//  the input's sequencer queue or with the
+//  frame of the JACK event, are compared
+//  with the times they were due.
+//
+//*****************************************//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RtMidi.h"
+
+static const unsigned int NOTES = 200;
+static const int64_t INTERVAL = 5000000; // 5 ms
+static const int64_t LEAD = 50000000;    // the first note is due 50 ms ahead
+
+static std::vector<int64_t> arrivals;
+
+static void arrived( const RtMidiIn::MessageInfo &info, const unsigned char *, size_t, void * )
+{
+  arrivals.push_back( info.monotonicTime );
+}
+
+// Send NOTES notes due every INTERVAL, and report how far their
+// arrival was from their due time.
+static bool run( RtMidiOut &out, bool scheduled )
+{
+  arrivals.clear();
+  int64_t start = RtMidiIn::getMonotonicTime() + LEAD;
+  unsigned char note[3] = { 0x90, 60, 100 };
+  for ( unsigned int i = 0; i < NOTES; i++ ) {
+    int64_t due = start + i * INTERVAL;
+    note[1] = (unsigned char) ( i & 0x7F );
+    if ( scheduled )
+      out.sendMessageAt( due, note, 3 );
+    else {
+      std::this_thread::sleep_for( std::chrono::nanoseconds( due - RtMidiIn::getMonotonicTime() ) );
+      out.sendMessage( note, 3 );
+    }
+  }
+  std::this_thread::sleep_for( std::chrono::nanoseconds( start + NOTES * INTERVAL + LEAD -
+                                                         RtMidiIn::getMonotonicTime() ) );
+
+  if ( arrivals.size() != NOTES ) {
+    std::cout << arrivals.size() << " of " << NOTES << " notes received\n";
+    return false;
+  }
+  double sum = 0.0, squares = 0.0, worst = 0.0;
+  for ( unsigned int i = 0; i < NOTES; i++ ) {
+    double late = ( arrivals[i] - ( start + i * INTERVAL ) ) / 1000.0;
+    sum += late;
+    squares += late * late;
+    worst = std::max( worst, std::fabs( late ) );
+  }
+  double mean = sum / NOTES;
+  std::cout << std::fixed << std::setprecision( 1 )
+            << ( scheduled ? "scheduled: " : "direct:    " ) << "mean " << mean
+            << " us late, jitter " << std::sqrt( squares / NOTES - mean * mean )
+            << " us, worst " << worst << " us\n";
+  return true;
+}
+
+static int jitter( RtMidi::Api api )
+{
+  std::vector<RtMidi::Api> apis;
+  RtMidi::getCompiledApi( apis );
+  std::string name = RtMidi::getApiDisplayName( api );
+  if ( std::find( apis.begin(), apis.end(), api ) == apis.end() ) {
+    std::cout << name << " not compiled in, skipping the jitter test\n";
+    return 0;
+  }
+
+  try {
+    RtMidiIn in( api, "schedjitter" );
+    RtMidiOut out( api, "schedjitter" );
+
+    in.setCallback( &arrived );
+    in.openVirtualPort( "schedjitter in" );
+    unsigned int port = out.getPortCount();
+    for ( unsigned int i = 0; i < out.getPortCount(); i++ ) {
+      if ( out.getPortName( i ).find( "schedjitter in" ) != std::string::npos ) port = i;
+    }
+    if ( port == out.getPortCount() ) {
+      std::cout << "Virtual input port not found\n";
+      return 1;
+    }
+    out.openPort( port );
+    arrivals.reserve( NOTES );
+
+    std::cout << name << ":\n";
+    if ( !run( out, false ) ) return 1;
+    if ( !run( out, true ) ) return 1;
+  }
+  catch ( RtMidiError &error ) {
+    std::cout << "No " << name << " server, skipping the jitter test: " << error.getMessage() << "\n";
+  }
+  return 0;
+}
+
+int main()
+{
+  if ( jitter( RtMidi::LINUX_ALSA ) ) return 1;
+  return jitter( RtMidi::UNIX_JACK );
+}
@@ -0,0 +1,168 @@
+//*****************************************//
+//  timestamps.cpp
+//
+//  Test for the integer message times.
+//  Messages delivered with deltas that
+//  have no exact double representation in
+//  seconds are read back from the queue
+//  and through the callbacks.  The integer
+//  deltas must add up exactly to the
+//  distance between the absolute times,
+//  and the double time stamps must be the
+//  deltas converted to seconds.
+//
+//*****************************************//
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "RtMidi.h"
+
+static const unsigned int MESSAGES = 3000;
+static const RtMidiIn::Duration DELTA( 333333 );   // a third of a millisecond
+static const RtMidiIn::TimePoint START( std::chrono::seconds( 1000 ) );
+
+static void deliverAll( MidiInApi::RtMidiInData *data )
+{
+  unsigned char note[3] = { 0x90, 60, 100 };
+  for ( unsigned int i = 0; i < MESSAGES; i++ ) {
+    note[1] = (unsigned char) ( i & 0x7F );
+    data->deliver( note, 3, i ? DELTA : RtMidiIn::Duration( 0 ), START + i * DELTA );
+  }
+  data->flushBatch();
+}
+
+// Check the times of the messages read back against the delivered ones.
+static bool check( const std::string &name, const std::vector<RtMidiIn::Duration> &deltas,
+                   const std::vector<RtMidiIn::TimePoint> &times, const std::vector<double> &timeStamps )
+{
+  if ( deltas.size() != MESSAGES || times.size() != MESSAGES || timeStamps.size() != MESSAGES ) {
+    std::cout << name << ": " << deltas.size() << " of " << MESSAGES << " messages received\n";
+    return false;
+  }
+
+  RtMidiIn::Duration sum( 0 );
+  double seconds = 0.0;
+  for ( unsigned int i = 0; i < MESSAGES; i++ ) {
+    if ( times[i] != START + i * DELTA ||
+         timeStamps[i] != std::chrono::duration<double>( deltas[i] ).count() ) {
+      std::cout << name << ": wrong time for message " << i << "\n";
+      return false;
+    }
+    sum += deltas[i];
+    seconds += timeStamps[i];
+  }
+  if ( sum != times.back() - times.front() ) {
+    std::cout << name << ": the deltas add up to " << sum.count() << " ns instead of "
+              << ( times.back() - times.front() ).count() << " ns\n";
+    return false;
+  }
+
+  double drift = seconds - std::chrono::duration<double>( sum ).count();
+  std::cout << name << ": deltas exact, summed double time stamps off by " << drift * 1e9 << " ns\n";
+  return true;
+}
+
+static std::vector<RtMidiIn::Duration> deltas;
+static std::vector<RtMidiIn::TimePoint> times;
+static std::vector<double> timeStamps;
+
+static void clear()
+{
+  deltas.clear();
+  times.clear();
+  timeStamps.clear();
+}
+
+static void infoReceived( const RtMidiIn::MessageInfo &info, const unsigned char *, size_t, void * )
+{
+  if ( info.monotonicTime != info.time.time_since_epoch().count() ) return;
+  deltas.push_back( info.delta );
+  times.push_back( info.time );
+  timeStamps.push_back( info.timeStamp );
+}
+
+static void batchReceived( size_t count, const unsigned char *, const size_t *,
+                           const RtMidiIn::Duration *d, const RtMidiIn::TimePoint *t, void * )
+{
+  for ( size_t i = 0; i < count; i++ ) {
+    deltas.push_back( d[i] );
+    times.push_back( t[i] );
+    timeStamps.push_back( std::chrono::duration<double>( d[i] ).count() );
+  }
+}
+
+static std::vector<double> legacyStamps;
+
+static void legacyReceived( size_t count, const unsigned char *, const size_t *,
+                            const double *s, const int64_t *, void * )
+{
+  legacyStamps.insert( legacyStamps.end(), s, s + count );
+}
+
+int main()
+{
+  // Through the queue, one by one and in a batch.
+  {
+    MidiInApi::RtMidiInData data;
+    data.queue.init( 4096 );
+    deliverAll( &data );
+    clear();
+    std::vector<unsigned char> message;
+    RtMidiIn::Duration delta;
+    RtMidiIn::TimePoint time;
+    while ( data.queue.pop( &message, &delta, &time ) ) {
+      deltas.push_back( delta );
+      times.push_back( time );
+      timeStamps.push_back( std::chrono::duration<double>( delta ).count() );
+    }
+    if ( !check( "queue", deltas, times, timeStamps ) ) return 1;
+
+    deliverAll( &data );
+    clear();
+    std::vector<unsigned char> bytes( 3 * MESSAGES );
+    std::vector<size_t> offsets( MESSAGES + 1 );
+    deltas.resize( MESSAGES );
+    times.resize( MESSAGES );
+    size_t count = data.queue.pop( bytes.data(), bytes.size(), offsets.data(), MESSAGES,
+                                   deltas.data(), times.data() );
+    deltas.resize( count );
+    times.resize( count );
+    for ( size_t i = 0; i < count; i++ )
+      timeStamps.push_back( std::chrono::duration<double>( deltas[i] ).count() );
+    if ( !check( "queue, batch", deltas, times, timeStamps ) ) return 1;
+  }
+
+  // Through the info callback.
+  {
+    MidiInApi::RtMidiInData data;
+    data.usingCallback = true;
+    data.infoCallback = &infoReceived;
+    clear();
+    deliverAll( &data );
+    if ( !check( "info callback", deltas, times, timeStamps ) ) return 1;
+  }
+
+  // Through the batch callbacks.
+  {
+    MidiInApi::RtMidiInData data;
+    data.usingCallback = true;
+    data.batching = true;
+    data.timedBatchCallback = &batchReceived;
+    clear();
+    deliverAll( &data );
+    if ( !check( "batch callback", deltas, times, timeStamps ) ) return 1;
+
+    std::vector<double> expected = timeStamps;
+    data.timedBatchCallback = 0;
+    data.batchCallback = &legacyReceived;
+    deliverAll( &data );
+    if ( legacyStamps != expected ) {
+      std::cout << "The double batch callback does not receive the converted deltas\n";
+      return 1;
+    }
+  }
+
+  return 0;
+}